@@ -5,6 +5,8 @@
 #include <gdk/gdkx.h>
 #endif
 
+#include <flutter_alone/flutter_alone_plugin.h>
+
 #include "flutter/generated_plugin_registrant.h"
 
 struct _MyApplication {
@@ -79,6 +81,19 @@ static void my_application_activate(GApplication* application) {
 // Implements GApplication::local_command_line.
 static gboolean my_application_local_command_line(GApplication* application, gchar*** arguments, int* exit_status) {
   MyApplication* self = MY_APPLICATION(application);
+
+  // Reject duplicate launches before the Flutter engine is started. The
+  // lock name must match LinuxConfig.lockFileName in lib/main.dart.
+  FlutterAloneCheckOptions alone_options = {};
+  alone_options.lock_file_name = "flutter_alone_example.lock";
+  alone_options.type = "en";
+  alone_options.show_message_box = TRUE;
+  alone_options.arguments = *arguments + 1;
+  if (flutter_alone_check_and_run(&alone_options) == FLUTTER_ALONE_CHECK_ALREADY_RUNNING) {
+    *exit_status = 0;
+    return TRUE;
+  }
+
   // Strip out the first argument as it is the binary name.
   self->dart_entrypoint_arguments = g_strdupv(*arguments + 1);
 
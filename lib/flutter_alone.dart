@@ -1,13 +1,22 @@
 import 'package:flutter/foundation.dart';
+import 'src/models/check_diagnostics.dart';
 import 'src/models/config.dart';
+import 'src/models/instance_info.dart';
+import 'src/models/lock_info.dart';
+import 'src/models/second_instance.dart';
 
 import 'flutter_alone_platform_interface.dart';
 
+export 'src/models/check_diagnostics.dart';
 export 'src/models/config.dart';
 export 'src/models/exception.dart';
+export 'src/models/instance_info.dart';
+export 'src/models/launch_file.dart';
 export 'src/models/linux_config.dart';
+export 'src/models/lock_info.dart';
 export 'src/models/macos_config.dart';
 export 'src/models/message_config.dart';
+export 'src/models/second_instance.dart';
 export 'src/models/windows_config.dart';
 
 /// Main class for the Flutter Alone plugin.
@@ -37,6 +46,68 @@ class FlutterAlone {
     return FlutterAlonePlatform.instance.checkAndRun(config: config);
   }
 
+  /// Launches that were rejected as duplicates of this instance.
+  ///
+  /// Each event carries the arguments, working directory and selected
+  /// environment of the rejected launch, e.g. files the user tried to open,
+  /// when it arrived and whether its activation token raised the window.
+  /// Launches that arrive before the first subscription are kept (up to 32)
+  /// and delivered to it. Currently only emitted on Linux.
+  Stream<SecondInstanceLaunch> get onSecondInstance =>
+      FlutterAlonePlatform.instance.onSecondInstance;
+
+  /// [onSecondInstance], grouped as the running instance delivered them.
+  ///
+  /// With [LinuxConfig.launchBatchWindow], a burst of launches arrives as a
+  /// single list, so the app can handle it with one state update; the list
+  /// length is the number of merged launches. Otherwise each list holds one
+  /// launch. Currently only emitted on Linux.
+  Stream<List<SecondInstanceLaunch>> get onSecondInstanceBatch =>
+      FlutterAlonePlatform.instance.onSecondInstanceBatch;
+
+  /// Emitted when this instance, running as a [LinuxConfig.standby], has
+  /// taken over the lock from an instance that exited.
+  ///
+  /// By then the plugin has shown the window again and this instance is the
+  /// primary: it receives [onSecondInstance] events and appears in
+  /// [getLockInfo]. Currently only emitted on Linux.
+  Stream<void> get onPromoted => FlutterAlonePlatform.instance.onPromoted;
+
+  /// Details of the lock held by this instance, or null when none is held.
+  ///
+  /// Reports where the lock lives and whether it was synced to disk, so the
+  /// chosen [LinuxConfig.lockDirectory] can be audited. Currently only
+  /// available on Linux.
+  Future<LockInfo?> getLockInfo() => FlutterAlonePlatform.instance.getLockInfo();
+
+  /// Where the time of the most recent check went, or null when none has
+  /// completed.
+  ///
+  /// Covers [checkAndRun], or the native pre-engine check whose lock it
+  /// adopted: per-phase timings (lock, owner verification, forwarding,
+  /// window activation, dialog) and the activation backend used. Meant for
+  /// startup telemetry. Currently only available on Linux.
+  Future<CheckDiagnostics?> getLastCheckDiagnostics() =>
+      FlutterAlonePlatform.instance.getLastCheckDiagnostics();
+
+  /// Running instances of the application, read from the shared instance
+  /// registry.
+  ///
+  /// Lists the instances sharing this instance's lock, or those of
+  /// [lockFileName] when given (e.g. before [checkAndRun]). Entries of
+  /// processes that exited without cleaning up are dropped. Currently only
+  /// available on Linux.
+  Future<List<InstanceInfo>> listInstances({String? lockFileName}) =>
+      FlutterAlonePlatform.instance.listInstances(lockFileName: lockFileName);
+
+  /// Closes the handles of [files] received with [onSecondInstance].
+  ///
+  /// Call once the files were read; until then each one keeps a file
+  /// descriptor open in this process. Handles already closed are ignored.
+  /// Currently only available on Linux.
+  Future<void> closeLaunchFiles(List<LaunchFile> files) =>
+      FlutterAlonePlatform.instance.closeLaunchFiles(files);
+
   /// Clean up resources when application closes.
   Future<void> dispose() async {
     await FlutterAlonePlatform.instance.dispose();
@@ -1,13 +1,66 @@
+import 'dart:async';
+
 import 'package:flutter/services.dart';
 
 import 'flutter_alone_platform_interface.dart';
+import 'src/models/check_diagnostics.dart';
 import 'src/models/config.dart';
 import 'src/models/exception.dart';
+import 'src/models/instance_info.dart';
+import 'src/models/launch_file.dart';
+import 'src/models/lock_info.dart';
+import 'src/models/second_instance.dart';
 
 /// Platform implementation using method channel
 class MethodChannelFlutterAlone extends FlutterAlonePlatform {
   final MethodChannel _channel = const MethodChannel('flutter_alone');
 
+  final EventChannel _launchChannel =
+      const EventChannel('flutter_alone/launches');
+
+  // Each event is a batch of one or more launches.
+  late final Stream<List<SecondInstanceLaunch>> _secondInstanceBatches =
+      _launchChannel.receiveBroadcastStream().map((event) => (event as List)
+          .map((launch) =>
+              SecondInstanceLaunch.fromMap(launch as Map<dynamic, dynamic>))
+          .toList());
+
+  late final StreamController<void> _promotedController =
+      StreamController<void>.broadcast(onListen: _handleMethodCalls);
+
+  bool _handlingMethodCalls = false;
+
+  // Registered on the first onPromoted listen instead of in the
+  // constructor: the platform instance is created during static
+  // initialization, possibly before WidgetsFlutterBinding.ensureInitialized(),
+  // and registering a handler needs the binding.
+  void _handleMethodCalls() {
+    if (_handlingMethodCalls) return;
+    _handlingMethodCalls = true;
+    _channel.setMethodCallHandler(_handleMethodCall);
+  }
+
+  Future<dynamic> _handleMethodCall(MethodCall call) async {
+    switch (call.method) {
+      case 'onPromoted':
+        _promotedController.add(null);
+        return null;
+      default:
+        throw MissingPluginException();
+    }
+  }
+
+  @override
+  Stream<SecondInstanceLaunch> get onSecondInstance =>
+      _secondInstanceBatches.expand((batch) => batch);
+
+  @override
+  Stream<List<SecondInstanceLaunch>> get onSecondInstanceBatch =>
+      _secondInstanceBatches;
+
+  @override
+  Stream<void> get onPromoted => _promotedController.stream;
+
   @override
   Future<bool> checkAndRun({required FlutterAloneConfig config}) async {
     try {
@@ -33,6 +86,72 @@ class MethodChannelFlutterAlone extends FlutterAlonePlatform {
     }
   }
 
+  @override
+  Future<LockInfo?> getLockInfo() async {
+    try {
+      final result =
+          await _channel.invokeMapMethod<dynamic, dynamic>('getLockInfo');
+      return result == null ? null : LockInfo.fromMap(result);
+    } on PlatformException catch (e) {
+      throw AloneException(
+        code: e.code,
+        message: e.message ?? 'Error reading lock information',
+        details: e.details,
+      );
+    }
+  }
+
+  @override
+  Future<CheckDiagnostics?> getLastCheckDiagnostics() async {
+    try {
+      final result = await _channel
+          .invokeMapMethod<dynamic, dynamic>('getLastCheckDiagnostics');
+      return result == null ? null : CheckDiagnostics.fromMap(result);
+    } on PlatformException catch (e) {
+      throw AloneException(
+        code: e.code,
+        message: e.message ?? 'Error reading check diagnostics',
+        details: e.details,
+      );
+    }
+  }
+
+  @override
+  Future<List<InstanceInfo>> listInstances({String? lockFileName}) async {
+    try {
+      final result = await _channel.invokeListMethod<dynamic>(
+        'listInstances',
+        {'lockFileName': lockFileName},
+      );
+      return (result ?? const [])
+          .map((entry) => InstanceInfo.fromMap(entry as Map<dynamic, dynamic>))
+          .toList();
+    } on PlatformException catch (e) {
+      throw AloneException(
+        code: e.code,
+        message: e.message ?? 'Error listing instances',
+        details: e.details,
+      );
+    }
+  }
+
+  @override
+  Future<void> closeLaunchFiles(List<LaunchFile> files) async {
+    if (files.isEmpty) return;
+    try {
+      await _channel.invokeMethod<void>(
+        'closeLaunchFiles',
+        {'fds': files.map((file) => file.fd).toList()},
+      );
+    } on PlatformException catch (e) {
+      throw AloneException(
+        code: e.code,
+        message: e.message ?? 'Error closing launch files',
+        details: e.details,
+      );
+    }
+  }
+
   @override
   Future<void> dispose() async {
     try {
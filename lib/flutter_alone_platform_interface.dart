@@ -1,4 +1,9 @@
+import 'package:flutter_alone/src/models/check_diagnostics.dart';
 import 'package:flutter_alone/src/models/config.dart';
+import 'package:flutter_alone/src/models/instance_info.dart';
+import 'package:flutter_alone/src/models/launch_file.dart';
+import 'package:flutter_alone/src/models/lock_info.dart';
+import 'package:flutter_alone/src/models/second_instance.dart';
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
 import 'flutter_alone_method_channel.dart';
@@ -32,4 +37,41 @@ abstract class FlutterAlonePlatform extends PlatformInterface {
 
   /// Clean up resources (release mutex, delete lock file).
   Future<void> dispose();
+
+  /// Details of the lock held by this instance, or null when none is held.
+  Future<LockInfo?> getLockInfo() {
+    throw UnimplementedError('getLockInfo() has not been implemented.');
+  }
+
+  /// Timing of the most recent check, or null when none has completed.
+  Future<CheckDiagnostics?> getLastCheckDiagnostics() {
+    throw UnimplementedError(
+        'getLastCheckDiagnostics() has not been implemented.');
+  }
+
+  /// Running instances published in the shared instance registry.
+  Future<List<InstanceInfo>> listInstances({String? lockFileName}) {
+    throw UnimplementedError('listInstances() has not been implemented.');
+  }
+
+  /// Releases files received with a second-instance launch.
+  Future<void> closeLaunchFiles(List<LaunchFile> files) {
+    throw UnimplementedError('closeLaunchFiles() has not been implemented.');
+  }
+
+  /// Launches rejected as duplicates of this instance.
+  Stream<SecondInstanceLaunch> get onSecondInstance {
+    throw UnimplementedError('onSecondInstance has not been implemented.');
+  }
+
+  /// Launches rejected as duplicates of this instance, as delivered together.
+  Stream<List<SecondInstanceLaunch>> get onSecondInstanceBatch {
+    throw UnimplementedError(
+        'onSecondInstanceBatch has not been implemented.');
+  }
+
+  /// Takeovers of the lock by this instance while it was a standby.
+  Stream<void> get onPromoted {
+    throw UnimplementedError('onPromoted has not been implemented.');
+  }
 }
@@ -0,0 +1,104 @@
+import 'linux_config.dart';
+
+/// One timed step of a check, e.g. `acquireLock` or `x11Activate`.
+class CheckPhase {
+  /// Phase name as reported by the platform.
+  final String name;
+
+  /// When the phase started, relative to the start of the check.
+  final Duration start;
+
+  /// How long the phase took.
+  final Duration duration;
+
+  const CheckPhase({
+    required this.name,
+    required this.start,
+    required this.duration,
+  });
+
+  /// Create from a MethodChannel map.
+  factory CheckPhase.fromMap(Map<dynamic, dynamic> map) {
+    return CheckPhase(
+      name: map['name'] as String? ?? '',
+      start: Duration(microseconds: map['startUs'] as int? ?? 0),
+      duration: Duration(microseconds: map['durationUs'] as int? ?? 0),
+    );
+  }
+
+  @override
+  String toString() =>
+      'CheckPhase($name, start: ${start.inMicroseconds}us, duration: ${duration.inMicroseconds}us)';
+}
+
+/// Where the time of the most recent check went, for startup telemetry.
+///
+/// Returned by [FlutterAlone.getLastCheckDiagnostics]. Times come from the
+/// monotonic clock. Currently only available on Linux.
+class CheckDiagnostics {
+  /// `acquired`, `alreadyRunning`, `error`, `cancelled`, or `promoted` when a
+  /// [LinuxConfig.standby] instance took over the lock. A promotion is
+  /// timed from the moment the owner's exit was noticed.
+  final String outcome;
+
+  /// The lock backend used by the check.
+  final LinuxLockMode lockMode;
+
+  /// Whether the check ran natively before the Flutter engine started
+  /// (`flutter_alone_check_and_run`) rather than from [FlutterAlone.checkAndRun].
+  final bool preEngine;
+
+  /// Duration of the whole check.
+  final Duration total;
+
+  /// Timed steps in the order they finished.
+  final List<CheckPhase> phases;
+
+  /// Whether the launch was delivered to the running instance.
+  final bool forwarded;
+
+  /// How the running instance's window was activated: `activationToken`,
+  /// `x11PublishedWindow`, `x11Xres`, `x11NetWmPid`, `xdotool`, or
+  /// `coalesced` when the running instance batched the launch with others
+  /// and another launch of the batch activates the window. Null when no
+  /// activation was attempted.
+  final String? activationBackend;
+
+  /// Whether [activationBackend] succeeded.
+  final bool activationSucceeded;
+
+  const CheckDiagnostics({
+    required this.outcome,
+    required this.lockMode,
+    this.preEngine = false,
+    this.total = Duration.zero,
+    this.phases = const [],
+    this.forwarded = false,
+    this.activationBackend,
+    this.activationSucceeded = false,
+  });
+
+  /// Create from a MethodChannel map.
+  factory CheckDiagnostics.fromMap(Map<dynamic, dynamic> map) {
+    final phases = map['phases'] as List<dynamic>? ?? const [];
+    return CheckDiagnostics(
+      outcome: map['outcome'] as String? ?? '',
+      lockMode: map['lockMode'] == 'socket'
+          ? LinuxLockMode.socket
+          : LinuxLockMode.file,
+      preEngine: map['preEngine'] as bool? ?? false,
+      total: Duration(microseconds: map['totalUs'] as int? ?? 0),
+      phases: phases
+          .map((phase) => CheckPhase.fromMap(phase as Map<dynamic, dynamic>))
+          .toList(),
+      forwarded: map['forwarded'] as bool? ?? false,
+      activationBackend: map['activationBackend'] as String?,
+      activationSucceeded: map['activationSucceeded'] as bool? ?? false,
+    );
+  }
+
+  @override
+  String toString() =>
+      'CheckDiagnostics(outcome: $outcome, total: ${total.inMicroseconds}us, '
+      'phases: ${phases.length}, activationBackend: $activationBackend)';
+}
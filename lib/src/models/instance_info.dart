@@ -0,0 +1,56 @@
+/// A running instance of the application, as published in the shared
+/// instance registry.
+///
+/// Returned by [FlutterAlone.listInstances]. Currently only available on
+/// Linux.
+class InstanceInfo {
+  /// Process ID of the instance.
+  final int pid;
+
+  /// Process start time in clock ticks since boot. Together with [pid] it
+  /// identifies the process even after its PID is reused.
+  final int startTime;
+
+  /// Top-level X11 window of the instance, or null when not known.
+  final int? windowId;
+
+  /// Whether the instance holds the lock (or one of its slots).
+  final bool primary;
+
+  /// Whether the instance accepts forwarded launches.
+  final bool acceptsLaunches;
+
+  /// Lock slot held by the instance when [LinuxConfig.maxInstances] is
+  /// above 1, otherwise null.
+  final int? slot;
+
+  /// Abstract socket name of the instance's launch endpoint.
+  final String endpoint;
+
+  const InstanceInfo({
+    required this.pid,
+    required this.startTime,
+    this.windowId,
+    this.primary = false,
+    this.acceptsLaunches = false,
+    this.slot,
+    this.endpoint = '',
+  });
+
+  /// Create from a MethodChannel map.
+  factory InstanceInfo.fromMap(Map<dynamic, dynamic> map) {
+    return InstanceInfo(
+      pid: map['pid'] as int? ?? 0,
+      startTime: map['startTime'] as int? ?? 0,
+      windowId: map['windowId'] as int?,
+      primary: map['primary'] as bool? ?? false,
+      acceptsLaunches: map['acceptsLaunches'] as bool? ?? false,
+      slot: map['slot'] as int?,
+      endpoint: map['endpoint'] as String? ?? '',
+    );
+  }
+
+  @override
+  String toString() =>
+      'InstanceInfo(pid: $pid, primary: $primary, slot: $slot, windowId: $windowId)';
+}
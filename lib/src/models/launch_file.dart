@@ -0,0 +1,42 @@
+/// A file passed along with a [SecondInstanceLaunch].
+///
+/// The rejected instance opens the file and hands the open handle to the
+/// running instance, which reads it through [path]. Paths the running
+/// instance could not resolve itself, such as files in another mount
+/// namespace or already deleted temp files, stay readable. Release the
+/// handle with [FlutterAlone.closeLaunchFiles] once the file was read.
+/// Currently only available on Linux.
+class LaunchFile {
+  /// Index of the argument in [SecondInstanceLaunch.arguments] the file was
+  /// opened from, or null for the standard input of the rejected instance.
+  final int? argumentIndex;
+
+  /// File descriptor of the handle in the running instance.
+  final int fd;
+
+  /// Path that opens the handle, `/proc/self/fd/<fd>`.
+  final String path;
+
+  const LaunchFile({
+    this.argumentIndex,
+    required this.fd,
+    required this.path,
+  });
+
+  /// Whether this is the standard input of the rejected instance.
+  bool get isStdin => argumentIndex == null;
+
+  /// Create from an EventChannel map.
+  factory LaunchFile.fromMap(Map<dynamic, dynamic> map) {
+    final fd = map['fd'] as int? ?? -1;
+    return LaunchFile(
+      argumentIndex: map['argumentIndex'] as int?,
+      fd: fd,
+      path: map['path'] as String? ?? '/proc/self/fd/$fd',
+    );
+  }
+
+  @override
+  String toString() =>
+      'LaunchFile(argumentIndex: $argumentIndex, fd: $fd, path: $path)';
+}
@@ -1,9 +1,34 @@
 import 'config.dart';
 
+/// How the Linux implementation enforces a single instance.
+enum LinuxLockMode {
+  /// An advisory `flock` on [LinuxConfig.lockFileName] in
+  /// [LinuxConfig.lockDirectory], holding the owner's PID.
+  file,
+
+  /// An abstract-namespace Unix socket named after
+  /// [LinuxConfig.lockFileName] and the user ID. Nothing is written to disk,
+  /// tmp cleaners cannot remove it, and the kernel releases it when the
+  /// owner exits or crashes.
+  socket,
+}
+
+/// Where the Linux lock file is placed when [LinuxConfig.lockDirectoryPath]
+/// is not set.
+enum LinuxLockDirectory {
+  /// The system temporary directory (`$TMPDIR`, typically `/tmp`).
+  systemTemp,
+
+  /// `$XDG_RUNTIME_DIR` (a per-user tmpfs on systemd hosts), falling back to
+  /// a private `flutter_alone-<uid>` directory in the system temporary
+  /// directory.
+  runtime,
+}
+
 /// Configuration for Linux lock file.
 ///
-/// The lock file is placed in the system temporary directory
-/// (typically `/tmp` on Linux).
+/// By default the lock file is placed in the system temporary directory
+/// (typically `/tmp` on Linux); see [lockDirectory].
 /// Use a unique name per app to avoid collisions with other apps using this plugin.
 class LinuxConfig implements AloneConfig {
   /// The name of the lock file.
@@ -11,8 +36,108 @@ class LinuxConfig implements AloneConfig {
   /// Defaults to '.lockfile'.
   final String lockFileName;
 
+  /// Names of environment variables a rejected launch forwards to the
+  /// running instance along with its arguments and working directory.
+  /// See [FlutterAlone.onSecondInstance]. Defaults to none.
+  final List<String> forwardedEnvironment;
+
+  /// The lock backend. Defaults to [LinuxLockMode.file].
+  final LinuxLockMode lockMode;
+
+  /// Maximum number of instances allowed to run at once, 1 to 64.
+  ///
+  /// Values above 1 split the lock file into byte-range slots claimed with
+  /// open-file-description locks; the acquired slot is reported by
+  /// [FlutterAlone.getLockInfo]. When every slot is taken, the launch is
+  /// forwarded to the least recently activated instance. Requires
+  /// [LinuxLockMode.file], and all builds of an app must use the same value.
+  /// Defaults to 1.
+  final int maxInstances;
+
+  /// Where the lock file is placed. Defaults to
+  /// [LinuxLockDirectory.systemTemp], which matches earlier versions; all
+  /// builds of an app must agree on the directory to see each other's lock.
+  final LinuxLockDirectory lockDirectory;
+
+  /// Absolute directory for the lock file, overriding [lockDirectory].
+  /// Created with mode 0700 when missing.
+  final String? lockDirectoryPath;
+
+  /// How long to wait for the external `xdotool` helper when activating the
+  /// running instance. The helper is only used when no X11 or XWayland
+  /// connection is available; it is killed once the timeout elapses.
+  /// Defaults to 2 seconds.
+  final Duration activationTimeout;
+
+  /// When true, `checkAndRun` returns `false` as soon as a duplicate is
+  /// detected instead of waiting for the "already running" dialog to be
+  /// dismissed. The plugin then quits the application when the dialog is
+  /// closed (or [messageBoxTimeout] elapses), so do not call `exit` yourself
+  /// in this mode. Defaults to false.
+  final bool nonBlockingMessageBox;
+
+  /// Closes the non-blocking dialog automatically after this long.
+  /// Null keeps it open until the user closes it.
+  final Duration? messageBoxTimeout;
+
+  /// When set, a launch that finds the lock held waits up to this long for
+  /// it to be released before treating itself as a duplicate. Meant for
+  /// updaters and restarts that relaunch the app while the old process is
+  /// still exiting: the wait blocks on the owner's process handle, so the
+  /// new instance starts as soon as the old one is gone. Null (the default)
+  /// checks once.
+  final Duration? waitForLock;
+
+  /// When true, a launch that finds the lock held becomes a hot standby
+  /// instead of a duplicate: `checkAndRun` returns `false` without a dialog
+  /// or forwarding, the plugin hides the window, and the instance keeps
+  /// running. When the running instance exits, the standby takes over the
+  /// lock, shows its window and emits [FlutterAlone.onPromoted]. Do not
+  /// exit on a `false` result in this mode. Defaults to false.
+  final bool standby;
+
+  /// When set, the running instance collects launches rejected as
+  /// duplicates for up to this long (at most 250 ms) and handles them
+  /// together: one [FlutterAlone.onSecondInstanceBatch] event and a single
+  /// window activation, instead of one per launch. Meant for file managers
+  /// that start the app once per selected file. Null (the default) delivers
+  /// each launch right away.
+  final Duration? launchBatchWindow;
+
+  /// Delivers a batch early once this many launches were collected.
+  /// Only used with [launchBatchWindow]. Defaults to 64.
+  final int launchBatchMaxSize;
+
+  /// When true, a launch rejected as a duplicate opens the arguments that
+  /// name regular files and passes the open files to the running instance
+  /// as [SecondInstanceLaunch.files]. The running instance reads them
+  /// without resolving the paths itself, which also works for paths it
+  /// cannot see (another sandbox or mount namespace) and for temp files
+  /// deleted right after the launch. Defaults to false.
+  final bool forwardFiles;
+
+  /// When true, a launch rejected as a duplicate passes its standard input
+  /// to the running instance when it is a pipe, socket or file (not a
+  /// terminal), e.g. for `producer | app`. The running instance reads the
+  /// stream directly; nothing is copied. Defaults to false.
+  final bool forwardStdin;
+
   LinuxConfig({
     this.lockFileName = '.lockfile',
+    this.forwardedEnvironment = const [],
+    this.lockMode = LinuxLockMode.file,
+    this.maxInstances = 1,
+    this.lockDirectory = LinuxLockDirectory.systemTemp,
+    this.lockDirectoryPath,
+    this.activationTimeout = const Duration(seconds: 2),
+    this.nonBlockingMessageBox = false,
+    this.messageBoxTimeout,
+    this.waitForLock,
+    this.standby = false,
+    this.launchBatchWindow,
+    this.launchBatchMaxSize = 64,
+    this.forwardFiles = false,
+    this.forwardStdin = false,
   }) {
     if (lockFileName.isEmpty ||
         lockFileName.contains('/') ||
@@ -26,12 +151,86 @@ class LinuxConfig implements AloneConfig {
         'Must be a non-empty simple filename without path separators or special names',
       );
     }
+    if (maxInstances < 1 || maxInstances > 64) {
+      throw ArgumentError.value(
+        maxInstances,
+        'maxInstances',
+        'Must be between 1 and 64',
+      );
+    }
+    if (maxInstances > 1 && lockMode != LinuxLockMode.file) {
+      throw ArgumentError.value(
+        maxInstances,
+        'maxInstances',
+        'Only supported with LinuxLockMode.file',
+      );
+    }
+    if (lockDirectoryPath != null &&
+        (!lockDirectoryPath!.startsWith('/') ||
+            lockDirectoryPath!.contains('\x00'))) {
+      throw ArgumentError.value(
+        lockDirectoryPath,
+        'lockDirectoryPath',
+        'Must be an absolute path',
+      );
+    }
+    if (activationTimeout <= Duration.zero) {
+      throw ArgumentError.value(
+        activationTimeout,
+        'activationTimeout',
+        'Must be positive',
+      );
+    }
+    if (messageBoxTimeout != null && messageBoxTimeout! <= Duration.zero) {
+      throw ArgumentError.value(
+        messageBoxTimeout,
+        'messageBoxTimeout',
+        'Must be positive',
+      );
+    }
+    if (waitForLock != null && waitForLock! <= Duration.zero) {
+      throw ArgumentError.value(
+        waitForLock,
+        'waitForLock',
+        'Must be positive',
+      );
+    }
+    if (launchBatchWindow != null &&
+        (launchBatchWindow! <= Duration.zero ||
+            launchBatchWindow! > const Duration(milliseconds: 250))) {
+      throw ArgumentError.value(
+        launchBatchWindow,
+        'launchBatchWindow',
+        'Must be positive and at most 250 ms',
+      );
+    }
+    if (launchBatchMaxSize < 1) {
+      throw ArgumentError.value(
+        launchBatchMaxSize,
+        'launchBatchMaxSize',
+        'Must be at least 1',
+      );
+    }
   }
 
   @override
   Map<String, dynamic> toMap() {
     return {
       'lockFileName': lockFileName,
+      'forwardedEnvironment': forwardedEnvironment,
+      'lockMode': lockMode.name,
+      'maxInstances': maxInstances,
+      'lockDirectory': lockDirectory.name,
+      'lockDirectoryPath': lockDirectoryPath,
+      'activationTimeoutMs': activationTimeout.inMilliseconds,
+      'nonBlockingMessageBox': nonBlockingMessageBox,
+      'messageBoxTimeoutMs': messageBoxTimeout?.inMilliseconds ?? 0,
+      'waitForLockMs': waitForLock?.inMilliseconds ?? 0,
+      'standby': standby,
+      'launchBatchWindowMs': launchBatchWindow?.inMilliseconds ?? 0,
+      'launchBatchMaxSize': launchBatchMaxSize,
+      'forwardFiles': forwardFiles,
+      'forwardStdin': forwardStdin,
     };
   }
 }
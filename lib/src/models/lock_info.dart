@@ -0,0 +1,53 @@
+import 'linux_config.dart';
+
+/// Details of the lock currently held by this instance, for auditing.
+///
+/// Returned by [FlutterAlone.getLockInfo]. Currently only available on Linux.
+class LockInfo {
+  /// The lock backend in use.
+  final LinuxLockMode mode;
+
+  /// Lock file path, or `@` followed by the abstract socket name for
+  /// [LinuxLockMode.socket].
+  final String path;
+
+  /// Directory the lock file was placed in. Null for [LinuxLockMode.socket].
+  final String? directory;
+
+  /// File system type of [directory], e.g. `tmpfs` or `ext4`. Null for
+  /// [LinuxLockMode.socket].
+  final String? filesystem;
+
+  /// Whether the PID record was flushed with `fdatasync`. Skipped on tmpfs
+  /// and ramfs, where there is no disk to sync to.
+  final bool synced;
+
+  /// Slot held by this instance when [LinuxConfig.maxInstances] is above 1,
+  /// otherwise null.
+  final int? slot;
+
+  const LockInfo({
+    required this.mode,
+    required this.path,
+    this.directory,
+    this.filesystem,
+    this.synced = false,
+    this.slot,
+  });
+
+  /// Create from a MethodChannel map.
+  factory LockInfo.fromMap(Map<dynamic, dynamic> map) {
+    return LockInfo(
+      mode: map['mode'] == 'socket' ? LinuxLockMode.socket : LinuxLockMode.file,
+      path: map['path'] as String? ?? '',
+      directory: map['directory'] as String?,
+      filesystem: map['filesystem'] as String?,
+      synced: map['synced'] as bool? ?? false,
+      slot: map['slot'] as int?,
+    );
+  }
+
+  @override
+  String toString() =>
+      'LockInfo(mode: ${mode.name}, path: $path, filesystem: $filesystem, synced: $synced)';
+}
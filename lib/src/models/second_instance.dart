@@ -0,0 +1,67 @@
+import 'launch_file.dart';
+
+/// Launch details forwarded by an instance that was rejected as a duplicate.
+///
+/// Delivered to the running instance through
+/// [FlutterAlone.onSecondInstance]. Currently only emitted on Linux.
+class SecondInstanceLaunch {
+  /// Process ID of the rejected instance.
+  final int pid;
+
+  /// Command-line arguments of the rejected instance, without the program name.
+  final List<String> arguments;
+
+  /// Working directory of the rejected instance.
+  final String workingDirectory;
+
+  /// Environment variables selected via [LinuxConfig.forwardedEnvironment].
+  final Map<String, String> environment;
+
+  /// When the running instance received the launch, or null when unknown.
+  final DateTime? timestamp;
+
+  /// Whether the running instance presented its window with the activation
+  /// token of the rejected launch. When false, the rejected instance
+  /// activates the window itself.
+  final bool activated;
+
+  /// Files passed with the launch when [LinuxConfig.forwardFiles] or
+  /// [LinuxConfig.forwardStdin] is set. Release them with
+  /// [FlutterAlone.closeLaunchFiles].
+  final List<LaunchFile> files;
+
+  const SecondInstanceLaunch({
+    required this.pid,
+    required this.arguments,
+    required this.workingDirectory,
+    this.environment = const {},
+    this.timestamp,
+    this.activated = false,
+    this.files = const [],
+  });
+
+  /// Create from an EventChannel map.
+  factory SecondInstanceLaunch.fromMap(Map<dynamic, dynamic> map) {
+    final timestamp = map['timestamp'] as int?;
+    return SecondInstanceLaunch(
+      pid: map['pid'] as int? ?? 0,
+      arguments: (map['arguments'] as List<dynamic>? ?? const [])
+          .cast<String>()
+          .toList(),
+      workingDirectory: map['workingDirectory'] as String? ?? '',
+      environment: (map['environment'] as Map<dynamic, dynamic>? ?? const {})
+          .cast<String, String>(),
+      timestamp: timestamp == null
+          ? null
+          : DateTime.fromMillisecondsSinceEpoch(timestamp),
+      activated: map['activated'] as bool? ?? false,
+      files: (map['files'] as List<dynamic>? ?? const [])
+          .map((file) => LaunchFile.fromMap(file as Map<dynamic, dynamic>))
+          .toList(),
+    );
+  }
+
+  @override
+  String toString() =>
+      'SecondInstanceLaunch(pid: $pid, arguments: $arguments, workingDirectory: $workingDirectory, activated: $activated, files: $files)';
+}
@@ -0,0 +1,413 @@
+// Latency of the native lock paths behind checkAndRun, without a Flutter
+// engine. Build with the standalone mode of linux/CMakeLists.txt:
+//
+//   cmake -S linux -B build && cmake --build build
+//   ./build/lock_benchmark
+//
+// File-backed cases run once on a memory-backed directory ($XDG_RUNTIME_DIR,
+// else /dev/shm) and once on a disk-backed one (FLUTTER_ALONE_BENCH_DISK_DIR,
+// else /var/tmp); the label names the file system actually measured.
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/statfs.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <linux/magic.h>
+
+#include "ipc_utils.h"
+#include "lock_utils.h"
+#include "process_utils.h"
+#include "registry_utils.h"
+
+namespace flutter_alone {
+namespace {
+
+constexpr int kSlotCount = 4;
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool is_memory_backed(const std::string& directory) {
+  struct statfs fs;
+  if (statfs(directory.c_str(), &fs) != 0) return false;
+  return fs.f_type == TMPFS_MAGIC || fs.f_type == RAMFS_MAGIC;
+}
+
+std::string lock_path(const std::string& directory, const char* name) {
+  return directory + "/flutter_alone_bench." + std::to_string(getpid()) + "." + name;
+}
+
+// The flock path of try_acquire_file_lock(): acquire_file_lock(), then
+// publish the record (synced on disk-backed directories).
+struct FileLock {
+  int fd = -1;
+  LockRecordPage* record = nullptr;
+};
+
+bool take_file_lock(const std::string& path, bool sync, const LockRecord& self,
+                    FileLock* lock) {
+  int fd = acquire_file_lock(path, nullptr);
+  if (fd < 0) return false;
+  LockRecordPage* record = map_lock_record(fd);
+  if (!record) {
+    release_file_lock(path, fd);
+    return false;
+  }
+  publish_lock_record(record, self, sync);
+  lock->fd = fd;
+  lock->record = record;
+  return true;
+}
+
+// The release_lock() path for a whole-file lock.
+void drop_file_lock(const std::string& path, FileLock* lock) {
+  unmap_lock_record(lock->record);
+  release_file_lock(path, lock->fd);
+  *lock = FileLock();
+}
+
+LockRecord make_self_record(const std::string& lock_name) {
+  LockRecord record;
+  record.pid = getpid();
+  record.start_time = get_process_start_time(record.pid);
+  record.boot_id = get_boot_id();
+  get_executable_id(record.pid, &record.exe_dev, &record.exe_ino);
+  record.ipc_address = make_abstract_socket_name(lock_name, "launch");
+  return record;
+}
+
+void set_filesystem_label(benchmark::State& state, const std::string& directory) {
+  state.SetLabel(directory + (is_memory_backed(directory) ? " (memory)" : " (disk)"));
+}
+
+// ------------------------------------------------------------------
+// flock + binary record (maxInstances == 1)
+// ------------------------------------------------------------------
+
+void BM_FileLock_Acquire(benchmark::State& state, std::string directory) {
+  std::string path = lock_path(directory, "file");
+  bool sync = !is_memory_backed(directory);
+  LockRecord self = make_self_record("bench.lock");
+  for (auto _ : state) {
+    FileLock lock;
+    Clock::time_point start = Clock::now();
+    bool ok = take_file_lock(path, sync, self, &lock);
+    state.SetIterationTime(seconds_since(start));
+    if (!ok) {
+      state.SkipWithError("acquire failed");
+      break;
+    }
+    drop_file_lock(path, &lock);
+  }
+  set_filesystem_label(state, directory);
+}
+
+void BM_FileLock_Release(benchmark::State& state, std::string directory) {
+  std::string path = lock_path(directory, "file");
+  bool sync = !is_memory_backed(directory);
+  LockRecord self = make_self_record("bench.lock");
+  for (auto _ : state) {
+    FileLock lock;
+    if (!take_file_lock(path, sync, self, &lock)) {
+      state.SkipWithError("acquire failed");
+      break;
+    }
+    Clock::time_point start = Clock::now();
+    drop_file_lock(path, &lock);
+    state.SetIterationTime(seconds_since(start));
+  }
+  set_filesystem_label(state, directory);
+}
+
+// A second launch: failed acquire_file_lock(), record read, close.
+void BM_FileLock_ContendedProbe(benchmark::State& state, std::string directory) {
+  std::string path = lock_path(directory, "file");
+  FileLock holder;
+  if (!take_file_lock(path, false, make_self_record("bench.lock"), &holder)) {
+    state.SkipWithError("acquire failed");
+    return;
+  }
+  for (auto _ : state) {
+    int fd = -1;
+    bool locked = acquire_file_lock(path, &fd) >= 0;
+    LockRecord record;
+    bool found = fd >= 0 && read_lock_record(fd, &record);
+    if (fd >= 0) close(fd);
+    if (locked || !found) {
+      state.SkipWithError("lock was not contended");
+      break;
+    }
+    benchmark::DoNotOptimize(record.pid);
+  }
+  drop_file_lock(path, &holder);
+  set_filesystem_label(state, directory);
+}
+
+// ------------------------------------------------------------------
+// OFD byte-range slots (maxInstances > 1)
+// ------------------------------------------------------------------
+
+void BM_SlotLock_Acquire(benchmark::State& state, std::string directory) {
+  std::string path = lock_path(directory, "slots");
+  bool sync = !is_memory_backed(directory);
+  LockSlotRecord self;
+  self.pid = getpid();
+  for (auto _ : state) {
+    Clock::time_point start = Clock::now();
+    int fd = open(path.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0644);
+    int slot = fd >= 0 ? acquire_lock_slot(fd, kSlotCount) : -1;
+    self.last_active_ms = current_time_ms();
+    bool ok = slot >= 0 && write_lock_slot(fd, slot, self, sync);
+    state.SetIterationTime(seconds_since(start));
+    if (!ok) {
+      state.SkipWithError("acquire failed");
+      break;
+    }
+    write_lock_slot(fd, slot, LockSlotRecord(), false);
+    close(fd);
+  }
+  unlink(path.c_str());
+  set_filesystem_label(state, directory);
+}
+
+// Every slot held: kSlotCount failed F_OFD_SETLK calls and one pread.
+void BM_SlotLock_ContendedProbe(benchmark::State& state, std::string directory) {
+  std::string path = lock_path(directory, "slots");
+  std::vector<int> holders;
+  for (int i = 0; i < kSlotCount; i++) {
+    int fd = open(path.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0 || acquire_lock_slot(fd, kSlotCount) < 0) {
+      state.SkipWithError("acquire failed");
+      return;
+    }
+    holders.push_back(fd);
+  }
+  for (auto _ : state) {
+    int fd = open(path.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0644);
+    int slot = acquire_lock_slot(fd, kSlotCount);
+    std::vector<LockSlotRecord> records = read_lock_slots(fd, kSlotCount);
+    close(fd);
+    if (slot >= 0) {
+      state.SkipWithError("lock was not contended");
+      break;
+    }
+    benchmark::DoNotOptimize(records.data());
+  }
+  for (int fd : holders) close(fd);
+  unlink(path.c_str());
+  set_filesystem_label(state, directory);
+}
+
+// ------------------------------------------------------------------
+// Abstract socket (lockMode: socket); no directory involved
+// ------------------------------------------------------------------
+
+std::string socket_lock_name() {
+  return "flutter_alone_bench." + std::to_string(getpid());
+}
+
+void BM_SocketLock_Acquire(benchmark::State& state) {
+  std::string name = socket_lock_name();
+  for (auto _ : state) {
+    Clock::time_point start = Clock::now();
+    int fd = create_lock_socket(name);
+    state.SetIterationTime(seconds_since(start));
+    if (fd < 0) {
+      state.SkipWithError("acquire failed");
+      break;
+    }
+    close(fd);
+  }
+}
+
+void BM_SocketLock_Release(benchmark::State& state) {
+  std::string name = socket_lock_name();
+  for (auto _ : state) {
+    int fd = create_lock_socket(name);
+    if (fd < 0) {
+      state.SkipWithError("acquire failed");
+      break;
+    }
+    Clock::time_point start = Clock::now();
+    close(fd);
+    state.SetIterationTime(seconds_since(start));
+  }
+}
+
+// Failed bind plus the SO_PEERCRED owner query. The holder lives in this
+// process, so its listen queue is drained between iterations.
+void BM_SocketLock_ContendedProbe(benchmark::State& state) {
+  std::string name = socket_lock_name();
+  int holder = create_lock_socket(name);
+  if (holder < 0) {
+    state.SkipWithError("acquire failed");
+    return;
+  }
+  for (auto _ : state) {
+    int fd = create_lock_socket(name);
+    pid_t owner = get_lock_socket_owner(name);
+    state.PauseTiming();
+    int client;
+    while ((client = accept4(holder, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) close(client);
+    state.ResumeTiming();
+    if (fd >= 0 || owner <= 0) {
+      state.SkipWithError("lock was not contended");
+      break;
+    }
+  }
+  close(holder);
+}
+
+// ------------------------------------------------------------------
+// Owner lookup and identity verification
+// ------------------------------------------------------------------
+
+// A child running this same binary, standing in for the lock owner.
+class OwnerProcess {
+ public:
+  OwnerProcess() {
+    pid_ = fork();
+    if (pid_ == 0) {
+      pause();
+      _exit(0);
+    }
+  }
+  ~OwnerProcess() {
+    if (pid_ > 0) {
+      kill(pid_, SIGKILL);
+      waitpid(pid_, nullptr, 0);
+    }
+  }
+  pid_t pid() const { return pid_; }
+
+ private:
+  pid_t pid_ = -1;
+};
+
+void BM_Identity_PidfdAndInode(benchmark::State& state) {
+  OwnerProcess owner;
+  uint64_t start_time = get_process_start_time(owner.pid());
+  get_self_executable();
+  for (auto _ : state) {
+    ProcessHandle handle = ProcessHandle::Open(owner.pid(), start_time);
+    bool same = handle.valid() && is_same_program(handle.pid()) && handle.IsAlive();
+    if (!same) {
+      state.SkipWithError("owner not verified");
+      break;
+    }
+  }
+}
+
+// The check this replaced: kill(0) and two readlinks compared as strings.
+void BM_Identity_LegacyReadlink(benchmark::State& state) {
+  OwnerProcess owner;
+  char proc_path[64];
+  snprintf(proc_path, sizeof(proc_path), "/proc/%d/exe", static_cast<int>(owner.pid()));
+  for (auto _ : state) {
+    char self_path[PATH_MAX];
+    char target_path[PATH_MAX];
+    bool running = kill(owner.pid(), 0) == 0;
+    ssize_t self_len = readlink("/proc/self/exe", self_path, sizeof(self_path) - 1);
+    ssize_t target_len = readlink(proc_path, target_path, sizeof(target_path) - 1);
+    bool same = running && self_len > 0 && self_len == target_len &&
+                memcmp(self_path, target_path, static_cast<size_t>(self_len)) == 0;
+    if (!same) {
+      state.SkipWithError("owner not verified");
+      break;
+    }
+  }
+}
+
+void BM_Registry_FindPrimary(benchmark::State& state) {
+  std::string name = "flutter_alone_bench." + std::to_string(getpid()) + ".registry";
+  std::unique_ptr<InstanceRegistry> registry = InstanceRegistry::Open(name);
+  if (!registry) {
+    state.SkipWithError("shared memory unavailable");
+    return;
+  }
+  InstanceInfo self;
+  self.pid = getpid();
+  self.start_time = get_process_start_time(self.pid);
+  self.flags = kInstanceFlagPrimary;
+  int index = registry->Register(self);
+  for (auto _ : state) {
+    InstanceInfo primary;
+    if (!registry->FindPrimary(&primary)) {
+      state.SkipWithError("primary not found");
+      break;
+    }
+    benchmark::DoNotOptimize(primary.pid);
+  }
+  registry->Unregister(index);
+  shm_unlink(("/flutter_alone." + std::to_string(getuid()) + "." + name).c_str());
+}
+
+std::string memory_directory() {
+  const char* runtime = getenv("XDG_RUNTIME_DIR");
+  if (runtime && *runtime && is_memory_backed(runtime)) return runtime;
+  return "/dev/shm";
+}
+
+std::string disk_directory() {
+  const char* dir = getenv("FLUTTER_ALONE_BENCH_DISK_DIR");
+  return dir && *dir ? dir : "/var/tmp";
+}
+
+void register_benchmarks() {
+  const struct {
+    const char* name;
+    std::string directory;
+  } directories[] = {
+    {"memory", memory_directory()},
+    {"disk", disk_directory()},
+  };
+  for (const auto& dir : directories) {
+    std::string suffix = std::string("/") + dir.name;
+    benchmark::RegisterBenchmark(("BM_FileLock_Acquire" + suffix).c_str(),
+                                 BM_FileLock_Acquire, dir.directory)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_FileLock_Release" + suffix).c_str(),
+                                 BM_FileLock_Release, dir.directory)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_FileLock_ContendedProbe" + suffix).c_str(),
+                                 BM_FileLock_ContendedProbe, dir.directory);
+    benchmark::RegisterBenchmark(("BM_SlotLock_Acquire" + suffix).c_str(),
+                                 BM_SlotLock_Acquire, dir.directory)->UseManualTime();
+    benchmark::RegisterBenchmark(("BM_SlotLock_ContendedProbe" + suffix).c_str(),
+                                 BM_SlotLock_ContendedProbe, dir.directory);
+  }
+  benchmark::RegisterBenchmark("BM_SocketLock_Acquire", BM_SocketLock_Acquire)->UseManualTime();
+  benchmark::RegisterBenchmark("BM_SocketLock_Release", BM_SocketLock_Release)->UseManualTime();
+  benchmark::RegisterBenchmark("BM_SocketLock_ContendedProbe", BM_SocketLock_ContendedProbe);
+  benchmark::RegisterBenchmark("BM_Identity_PidfdAndInode", BM_Identity_PidfdAndInode);
+  benchmark::RegisterBenchmark("BM_Identity_LegacyReadlink", BM_Identity_LegacyReadlink);
+  benchmark::RegisterBenchmark("BM_Registry_FindPrimary", BM_Registry_FindPrimary);
+}
+
+}  // namespace
+}  // namespace flutter_alone
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  flutter_alone::register_benchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include "include/flutter_alone/flutter_alone_plugin.h"
 
 #include <flutter_linux/flutter_linux.h>
+#include <glib-unix.h>
 #include <gtk/gtk.h>
 
 #include <cstring>
@@ -9,98 +10,184 @@
 #include <sstream>
 #include <cstdlib>
 #include <cerrno>
+#include <memory>
+#include <vector>
 
-#include <sys/file.h>
-#include <sys/stat.h>
-#include <sys/wait.h>
-#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <spawn.h>
 
 #ifdef HAVE_X11
 #include <X11/Xlib.h>
-#include <X11/Xatom.h>
 #include <gdk/gdkx.h>
 #endif
 
+#include "instance_lock.h"
+#include "ipc_utils.h"
+#include "lock_utils.h"
+#include "process_utils.h"
+#include "registry_utils.h"
+#include "window_utils.h"
+
 #define FLUTTER_ALONE_PLUGIN(obj) \
   (G_TYPE_CHECK_INSTANCE_CAST((obj), flutter_alone_plugin_get_type(), \
                               FlutterAlonePlugin))
 
 static constexpr char kChannelName[] = "flutter_alone";
+// Launches rejected as duplicates of this instance, one event each.
+static constexpr char kLaunchEventChannelName[] = "flutter_alone/launches";
 static constexpr char kMethodCheckAndRun[] = "checkAndRun";
+static constexpr char kMethodCloseLaunchFiles[] = "closeLaunchFiles";
 static constexpr char kMethodDispose[] = "dispose";
+static constexpr char kMethodGetLastCheckDiagnostics[] = "getLastCheckDiagnostics";
+static constexpr char kMethodGetLockInfo[] = "getLockInfo";
+static constexpr char kMethodListInstances[] = "listInstances";
+static constexpr char kMethodOnPromoted[] = "onPromoted";
+
+// A rejected instance that connects but stalls is dropped after this long.
+static constexpr guint kLaunchReadTimeoutSeconds = 5;
+
+// Launch events kept until Dart listens to kLaunchEventChannelName, e.g.
+// launches forwarded while the app is still starting; older ones are
+// dropped first.
+static constexpr guint kMaxPendingLaunchEvents = 32;
+
+// Upper bound for LinuxConfig.launchBatchWindow: a rejected launch waits at
+// most kLaunchForwardTimeoutMs for its ack.
+static constexpr int kMaxLaunchBatchWindowMs = 250;
+
+// Deadline for the external activation helper when none is configured.
+static constexpr int kDefaultActivationTimeoutMs = 2000;
+
+// How often a standby instance retries the lock when no event covers its
+// release: no pidfd for the owner, or other slot owners may free a slot.
+static constexpr guint kStandbyRecheckMs = 1000;
+
+// Lock and check logic shared with the standalone core library.
+using flutter_alone::CheckDiagnostics;
+using flutter_alone::LockAttempt;
+using flutter_alone::LockDirectory;
+using flutter_alone::LockMode;
+using flutter_alone::LockStatus;
+using flutter_alone::LockTarget;
+using flutter_alone::ScopedPhase;
+
+// A rejected instance (LinuxConfig.standby) that keeps running, hidden,
+// until it can take over the lock.
+struct StandbyWatch {
+  LockTarget target;
+  // The owner being waited on. Its pidfd becomes readable when it exits.
+  flutter_alone::ProcessHandle owner;
+  guint owner_watch_id = 0;
+  // Single-instance lock file: inotify watch catching an owner that
+  // unlinks it without exiting, or -1.
+  int file_watch_fd = -1;
+  guint file_watch_id = 0;
+  guint recheck_id = 0;
+  // An event arrived while a takeover attempt was already running.
+  bool retry_pending = false;
+  // Our top-level window and the handler keeping it hidden, or null.
+  GtkWidget* window = nullptr;
+  gulong show_handler_id = 0;
+};
 
 struct _FlutterAlonePlugin {
   GObject parent_instance;
+  // Lock file path, or "@<abstract name>" for the socket mode.
   gchar* lock_file_path;
   int lock_fd;
+  LockMode lock_mode;
+  // Mapped lock record (single-instance file mode), or null.
+  flutter_alone::LockRecordPage* lock_record;
+  // File system the lock file lives on, and whether its PID was synced.
+  gchar* lock_filesystem;
+  gboolean lock_synced;
+  // Instance slot held when maxInstances > 1, or -1.
+  gint lock_slot;
+  // Our top-level X11 window as published in the lock record and registry,
+  // or 0 until it is realized (and always on non-X11 GDK backends).
+  guint64 lock_window;
+  // Pending "realize" handler on the FlView that publishes lock_window, or 0.
+  gulong view_realize_id;
+  // Accepts owner queries on the lock socket (socket mode only), or 0.
+  guint lock_drain_id;
+  // Shared instance registry of the held lock and our entry in it, or null
+  // and -1 when shared memory is unavailable.
+  flutter_alone::InstanceRegistry* registry;
+  int registry_index;
+  // Weak pointers: the messenger owns the channels, and their handlers
+  // own us, so strong refs would keep both alive past teardown.
+  FlMethodChannel* channel;
+  FlEventChannel* launch_channel;
+  // Whether Dart listens to launch_channel. Until it does, launch events
+  // are queued in pending_launch_events (FlValue*).
+  gboolean launch_listening;
+  GPtrArray* pending_launch_events;
+  // Listening launch endpoint not yet handed to launch_service, or -1.
+  int launch_fd;
+  GSocketService* launch_service;
+  // Launches read but not yet delivered (LaunchConnection*), and the timer
+  // that delivers them as one batch, or 0.
+  GPtrArray* launch_batch;
+  guint launch_batch_timer_id;
+  // How long launches are collected before delivery, or 0 to deliver each
+  // one right away, and how many trigger delivery early
+  // (LinuxConfig.launchBatchWindow, launchBatchMaxSize).
+  int launch_batch_window_ms;
+  int launch_batch_max_size;
+  // Fds of launch files handed to Dart and not yet closed by
+  // closeLaunchFiles.
+  GHashTable* launch_files;
+  // Used to reach our top-level window when presenting it.
+  FlPluginRegistrar* registrar;
+  // Set while a checkAndRun worker is running; cancelled by dispose so a
+  // lock acquired afterwards is dropped instead of adopted.
+  GCancellable* check_cancellable;
+  // Set while waiting to take over the lock as a standby, or null.
+  StandbyWatch* standby;
 };
 
 G_DEFINE_TYPE(FlutterAlonePlugin, flutter_alone_plugin, g_object_get_type())
 
+// Lock acquired by flutter_alone_check_and_run() and not yet adopted by a
+// plugin instance.
+static int g_early_lock_fd = -1;
+static gchar* g_early_lock_file_path = nullptr;
+static LockMode g_early_lock_mode = LockMode::kFile;
+static flutter_alone::LockRecordPage* g_early_lock_record = nullptr;
+static gchar* g_early_lock_filesystem = nullptr;
+static gboolean g_early_lock_synced = FALSE;
+static gint g_early_lock_slot = -1;
+static int g_early_launch_fd = -1;
+static flutter_alone::InstanceRegistry* g_early_registry = nullptr;
+static int g_early_registry_index = -1;
+
 // ============================================================
-// Lock file helpers
+// Check diagnostics
 // ============================================================
 
-static std::string get_lock_file_path(const gchar* lock_file_name) {
-  const gchar* tmp_dir = g_get_tmp_dir();
-  return std::string(tmp_dir) + "/" + lock_file_name;
-}
-
-// Read PID from an already-opened file descriptor (avoids re-open TOCTOU)
-static pid_t read_pid_from_fd(int fd) {
-  char buf[32];
-  if (lseek(fd, 0, SEEK_SET) != 0) return -1;
-  ssize_t n = read(fd, buf, sizeof(buf) - 1);
-  if (n <= 0) return -1;
-  buf[n] = '\0';
-  char* end = nullptr;
-  long pid = strtol(buf, &end, 10);
-  if (end == buf || pid <= 0) return -1;
-  return static_cast<pid_t>(pid);
-}
-
-static bool is_process_running(pid_t pid) {
-  if (pid <= 0) return false;
-  if (kill(pid, 0) == 0) return true;
-  // errno == EPERM means the process exists but we lack permission (cross-user)
-  if (errno == EPERM) return true;
-  return false;
-}
-
-// Verify process identity by checking /proc/<pid>/exe
-static bool is_same_executable(pid_t pid) {
-  char self_path[PATH_MAX];
-  char target_path[PATH_MAX];
-
-  ssize_t self_len = readlink("/proc/self/exe", self_path, sizeof(self_path) - 1);
-  if (self_len < 0) return false;
-  self_path[self_len] = '\0';
+// Diagnostics of the most recent completed check, or null before the first.
+// Only touched on the main thread.
+static std::unique_ptr<CheckDiagnostics> g_last_check_diagnostics;
 
-  // "/proc/<max-pid>/exe" fits well within 64 chars
-  char proc_path[64];
-  snprintf(proc_path, sizeof(proc_path), "/proc/%d/exe", static_cast<int>(pid));
-  ssize_t target_len = readlink(proc_path, target_path, sizeof(target_path) - 1);
-  if (target_len < 0) return false;
-  target_path[target_len] = '\0';
-
-  return strcmp(self_path, target_path) == 0;
+static void finish_check_diagnostics(CheckDiagnostics diagnostics, const char* outcome) {
+  diagnostics.outcome = outcome;
+  diagnostics.total_us = flutter_alone::monotonic_time_us() - diagnostics.started_us;
+  g_last_check_diagnostics = std::make_unique<CheckDiagnostics>(std::move(diagnostics));
 }
 
-// Overwrites fd content with the decimal PID.
-// fd must be open for write and advisory-locked by the caller.
-static bool write_pid_to_fd(int fd, pid_t pid) {
-  if (ftruncate(fd, 0) != 0) return false;
-  if (lseek(fd, 0, SEEK_SET) != 0) return false;
+// ============================================================
+// Lock option parsing
+// ============================================================
 
-  std::string pid_str = std::to_string(pid);
-  ssize_t written = write(fd, pid_str.c_str(), pid_str.length());
-  if (written < 0 || static_cast<size_t>(written) != pid_str.length()) return false;
+static LockMode parse_lock_mode(const gchar* value) {
+  return value && strcmp(value, "socket") == 0 ? LockMode::kSocket : LockMode::kFile;
+}
 
-  fdatasync(fd);
-  return true;
+static LockDirectory parse_lock_directory(const gchar* value) {
+  return value && strcmp(value, "runtime") == 0 ? LockDirectory::kRuntime
+                                                : LockDirectory::kSystemTemp;
 }
 
 // ============================================================
@@ -109,145 +196,201 @@ static bool write_pid_to_fd(int fd, pid_t pid) {
 
 #ifdef HAVE_X11
 
-static bool is_x11_session() {
-  const char* session_type = getenv("XDG_SESSION_TYPE");
-  if (session_type && strcmp(session_type, "x11") == 0) return true;
-
-  GdkDisplay* display = gdk_display_get_default();
-  if (display && GDK_IS_X11_DISPLAY(display)) return true;
-
-  return false;
-}
+// Connection used for activation, always on the main thread. Once GTK is up
+// on X11 this is GDK's own Display, so a rejected checkAndRun launch needs
+// no connection setup or auth of its own. Otherwise (the pre-engine check,
+// or GDK on Wayland with XWayland available) a private connection is
+// opened on first use and kept until the plugin is disposed. Atoms are
+// interned once per connection.
+struct X11Context {
+  Display* display = nullptr;
+  // Set when display is GDK's; X errors are then trapped through GDK.
+  GdkDisplay* gdk_display = nullptr;
+  flutter_alone::X11Atoms atoms;
+#ifdef HAVE_XRES
+  flutter_alone::XResInfo xres;
+#endif
+};
 
-static constexpr long kMaxClientListItems = 4096;
+static X11Context g_x11;
+static X11Context g_gdk_x11;
 
-static Window find_window_by_pid(Display* display, Window root, pid_t target_pid) {
-  Atom pid_atom = XInternAtom(display, "_NET_WM_PID", True);
-  if (pid_atom == None) return None;
+// The thread GDK runs on, once the plugin exists. Activation requested from
+// other threads is run there.
+static GThread* g_main_thread = nullptr;
 
-  Atom actual_type;
-  int actual_format;
-  unsigned long nitems, bytes_after;
-  unsigned char* prop_data = nullptr;
+static void init_x11_context(X11Context* x11, Display* display) {
+  x11->display = display;
+  x11->atoms = flutter_alone::intern_x11_atoms(display);
+#ifdef HAVE_XRES
+  x11->xres = flutter_alone::query_xres_info(display);
+#endif
+}
 
-  Atom client_list_atom = XInternAtom(display, "_NET_CLIENT_LIST", True);
-  if (client_list_atom == None) return None;
+static void close_x11_context() {
+  if (g_x11.display) XCloseDisplay(g_x11.display);
+  g_x11 = X11Context();
+  g_gdk_x11 = X11Context();
+}
 
-  if (XGetWindowProperty(display, root, client_list_atom,
-                         0, kMaxClientListItems, False, XA_WINDOW,
-                         &actual_type, &actual_format,
-                         &nitems, &bytes_after, &prop_data) != Success) {
-    return None;
+static X11Context* get_x11_context() {
+  GdkDisplay* gdk_display = gdk_display_get_default();
+  if (gdk_display && GDK_IS_X11_DISPLAY(gdk_display)) {
+    if (g_gdk_x11.gdk_display != gdk_display) {
+      g_gdk_x11 = X11Context();
+      g_gdk_x11.gdk_display = gdk_display;
+      init_x11_context(&g_gdk_x11, gdk_x11_display_get_xdisplay(gdk_display));
+    }
+    return &g_gdk_x11;
   }
+  if (g_x11.display) return &g_x11;
 
-  if (!prop_data) return None;
+  Display* display = XOpenDisplay(nullptr);
+  if (!display) return nullptr;
+  init_x11_context(&g_x11, display);
+  return &g_x11;
+}
 
-  if (bytes_after > 0) {
-    g_warning("flutter_alone: _NET_CLIENT_LIST truncated, %lu bytes remaining", bytes_after);
+// window is the id target_pid published for itself, or 0. When it checks
+// out, no lookup is needed at all.
+static bool activate_window_x11(X11Context* x11, pid_t target_pid, uint64_t window,
+                                CheckDiagnostics* diagnostics) {
+  // A window closed mid-lookup raises BadWindow, which the default
+  // handlers (Xlib's before GTK is up, GDK's after) treat as fatal.
+  std::unique_ptr<flutter_alone::ScopedXErrorTrap> xlib_trap;
+  if (x11->gdk_display) {
+    gdk_x11_display_error_trap_push(x11->gdk_display);
+  } else {
+    xlib_trap.reset(new flutter_alone::ScopedXErrorTrap(x11->display));
   }
-
-  Window* windows = reinterpret_cast<Window*>(prop_data);
-  Window found = None;
-
-  for (unsigned long i = 0; i < nitems; i++) {
-    unsigned char* pid_data = nullptr;
-    Atom pid_actual_type;
-    int pid_actual_format;
-    unsigned long pid_nitems, pid_bytes_after;
-
-    if (XGetWindowProperty(display, windows[i], pid_atom,
-                           0, 1, False, XA_CARDINAL,
-                           &pid_actual_type, &pid_actual_format,
-                           &pid_nitems, &pid_bytes_after, &pid_data) == Success) {
-      if (pid_data && pid_nitems > 0) {
-        uint32_t window_pid = 0;
-        memcpy(&window_pid, pid_data, sizeof(uint32_t));
-        if (static_cast<pid_t>(window_pid) == target_pid) {
-          found = windows[i];
-          XFree(pid_data);
-          break;
-        }
-        XFree(pid_data);
-      }
+  Window target = None;
+  if (window != 0) {
+    ScopedPhase phase(diagnostics, "x11VerifyWindow");
+    if (flutter_alone::window_belongs_to_pid(x11->display, x11->atoms,
+                                             static_cast<Window>(window), target_pid)) {
+      target = static_cast<Window>(window);
+      diagnostics->activation_backend = "x11PublishedWindow";
     }
   }
-
-  XFree(prop_data);
-  return found;
+#ifdef HAVE_XRES
+  // Server-side PID lookup first; windows of clients the server cannot
+  // attribute (remote, some XWayland setups) still need _NET_WM_PID.
+  if (target == None) {
+    ScopedPhase phase(diagnostics, "x11XresLookup");
+    target = flutter_alone::find_window_by_pid_xres(x11->display, x11->atoms, x11->xres,
+                                                    target_pid);
+    diagnostics->activation_backend = "x11Xres";
+  }
+#endif
+  if (target == None) {
+    ScopedPhase phase(diagnostics, "x11NetWmPidLookup");
+    target = flutter_alone::find_window_by_pid(x11->display, x11->atoms, target_pid);
+    diagnostics->activation_backend = "x11NetWmPid";
+  }
+  bool activated = false;
+  if (target != None) {
+    ScopedPhase phase(diagnostics, "x11Activate");
+    activated = flutter_alone::activate_x11_window(x11->display, x11->atoms, target);
+  }
+  if (x11->gdk_display) gdk_x11_display_error_trap_pop_ignored(x11->gdk_display);
+  return activated;
 }
 
-static bool activate_window_x11(pid_t target_pid) {
-  Display* display = XOpenDisplay(nullptr);
-  if (!display) return false;
-
-  Window root = DefaultRootWindow(display);
-  Window target = find_window_by_pid(display, root, target_pid);
-
-  if (target == None) {
-    XCloseDisplay(display);
-    return false;
-  }
-
-  Atom active_atom = XInternAtom(display, "_NET_ACTIVE_WINDOW", True);
-  if (active_atom != None) {
-    XEvent event;
-    memset(&event, 0, sizeof(event));
-    event.xclient.type = ClientMessage;
-    event.xclient.serial = 0;
-    event.xclient.send_event = True;
-    event.xclient.display = display;
-    event.xclient.window = target;
-    event.xclient.message_type = active_atom;
-    event.xclient.format = 32;
-    // Source indication: 2 = pager (EWMH spec _NET_ACTIVE_WINDOW)
-    event.xclient.data.l[0] = 2;
-    event.xclient.data.l[1] = CurrentTime;
-    event.xclient.data.l[2] = 0;
-
-    XSendEvent(display, root, False,
-               SubstructureRedirectMask | SubstructureNotifyMask,
-               &event);
-
-    XMapRaised(display, target);
-    XFlush(display);
-  }
-
-  XCloseDisplay(display);
+// Connects and activates on the calling thread. Returns false without
+// touching activated when no X connection is available.
+static bool run_x11_activation(pid_t target_pid, uint64_t window,
+                               CheckDiagnostics* diagnostics, bool* activated) {
+  X11Context* x11;
+  {
+    ScopedPhase phase(diagnostics, "x11Connect");
+    x11 = get_x11_context();
+  }
+  if (!x11) return false;
+  *activated = activate_window_x11(x11, target_pid, window, diagnostics);
   return true;
 }
 
-#endif  // HAVE_X11
-
-// ============================================================
-// Wayland window activation (best-effort via xdotool on XWayland)
-// Uses posix_spawn instead of system() to avoid shell injection.
-// ============================================================
-
-extern char **environ;
+// An activation requested by the checkAndRun worker and run on the main
+// context, where GDK's Display may be used. Shared by both threads, so the
+// worker can give up waiting without the main thread writing freed memory.
+struct X11ActivationCall {
+  pid_t target_pid;
+  uint64_t window;
+  // Phases and backend recorded on the main thread.
+  CheckDiagnostics diagnostics;
+  bool connected = false;
+  bool activated = false;
+  bool done = false;
+  GMutex mutex;
+  GCond cond;
+  gint ref_count = 2;
+};
 
-static bool run_command(const char* prog, char* const argv[]) {
-  pid_t child_pid;
-  int status;
+static void x11_activation_call_unref(X11ActivationCall* call) {
+  if (!g_atomic_int_dec_and_test(&call->ref_count)) return;
+  g_mutex_clear(&call->mutex);
+  g_cond_clear(&call->cond);
+  delete call;
+}
 
-  posix_spawn_file_actions_t actions;
-  posix_spawn_file_actions_init(&actions);
+static gboolean x11_activation_call_cb(gpointer user_data) {
+  X11ActivationCall* call = static_cast<X11ActivationCall*>(user_data);
+  call->connected = run_x11_activation(call->target_pid, call->window, &call->diagnostics,
+                                       &call->activated);
+  g_mutex_lock(&call->mutex);
+  call->done = true;
+  g_cond_signal(&call->cond);
+  g_mutex_unlock(&call->mutex);
+  x11_activation_call_unref(call);
+  return G_SOURCE_REMOVE;
+}
 
-  if (posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0) != 0 ||
-      posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) != 0) {
-    posix_spawn_file_actions_destroy(&actions);
-    return false;
+// run_x11_activation() on the main thread. The worker waits for it at most
+// timeout_ms, e.g. while the main loop is busy.
+static bool run_x11_activation_on_main(pid_t target_pid, uint64_t window, int timeout_ms,
+                                       CheckDiagnostics* diagnostics, bool* activated) {
+  X11ActivationCall* call = new X11ActivationCall();
+  call->target_pid = target_pid;
+  call->window = window;
+  call->diagnostics.started_us = diagnostics->started_us;
+  g_mutex_init(&call->mutex);
+  g_cond_init(&call->cond);
+  g_main_context_invoke(nullptr, x11_activation_call_cb, call);
+
+  gint64 deadline = g_get_monotonic_time() + timeout_ms * G_TIME_SPAN_MILLISECOND;
+  g_mutex_lock(&call->mutex);
+  while (!call->done && g_cond_wait_until(&call->cond, &call->mutex, deadline)) {}
+  bool done = call->done;
+  g_mutex_unlock(&call->mutex);
+
+  bool connected = false;
+  if (done) {
+    diagnostics->phases.insert(diagnostics->phases.end(), call->diagnostics.phases.begin(),
+                               call->diagnostics.phases.end());
+    diagnostics->activation_backend = call->diagnostics.activation_backend;
+    connected = call->connected;
+    *activated = call->activated;
+  } else {
+    // Counts as a failed activation; xdotool would block on the same
+    // server.
+    g_warning("flutter_alone: main loop did not run X11 activation within %d ms", timeout_ms);
+    connected = true;
+    *activated = false;
   }
+  x11_activation_call_unref(call);
+  return connected;
+}
 
-  int ret = posix_spawnp(&child_pid, prog, &actions, nullptr, argv, environ);
-  posix_spawn_file_actions_destroy(&actions);
-
-  if (ret != 0) return false;
+#endif  // HAVE_X11
 
-  waitpid(child_pid, &status, 0);
-  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
-}
+// ============================================================
+// Wayland window activation fallback (xdotool on XWayland)
+// Only used when no in-process X connection can be opened.
+// Spawned directly (run_command) instead of through system() to avoid shell
+// injection.
+// ============================================================
 
-static bool activate_window_wayland(pid_t target_pid) {
+static bool activate_window_wayland(pid_t target_pid, int timeout_ms) {
   std::string pid_str = std::to_string(static_cast<int>(target_pid));
 
   // Do NOT pass --onlyvisible: a tray-minimized / hidden main window must still
@@ -263,16 +406,30 @@ static bool activate_window_wayland(pid_t target_pid) {
     const_cast<char*>("windowactivate"),
     nullptr
   };
-  return run_command("xdotool", argv);
+  if (flutter_alone::run_command("xdotool", argv, timeout_ms)) return true;
+  if (errno == ETIMEDOUT) {
+    g_warning("flutter_alone: xdotool did not finish within %d ms, killed it", timeout_ms);
+  }
+  return false;
 }
 
-static bool activate_existing_window(pid_t target_pid) {
+static bool activate_existing_window(pid_t target_pid, uint64_t window, int timeout_ms,
+                                     CheckDiagnostics* diagnostics) {
 #ifdef HAVE_X11
-  if (is_x11_session()) {
-    if (activate_window_x11(target_pid)) return true;
+  // Set on X11 sessions, and under Wayland when XWayland is available; the
+  // EWMH path reaches the same windows xdotool would, without spawning a
+  // process.
+  if (getenv("DISPLAY")) {
+    bool activated = false;
+    bool connected = g_main_thread && g_thread_self() != g_main_thread
+        ? run_x11_activation_on_main(target_pid, window, timeout_ms, diagnostics, &activated)
+        : run_x11_activation(target_pid, window, diagnostics, &activated);
+    if (connected) return activated;
   }
 #endif
-  return activate_window_wayland(target_pid);
+  ScopedPhase phase(diagnostics, "xdotool");
+  diagnostics->activation_backend = "xdotool";
+  return activate_window_wayland(target_pid, timeout_ms);
 }
 
 // ============================================================
@@ -283,6 +440,10 @@ static bool activate_existing_window(pid_t target_pid) {
 static void show_message_dialog(const gchar* title, const gchar* message, gboolean should_show) {
   if (!should_show) return;
 
+  // No-op once GTK is up; needed for the pre-engine check, which runs before
+  // GtkApplication startup. Without a display the notice is skipped.
+  if (!gtk_init_check(nullptr, nullptr)) return;
+
   GtkWidget* dialog = gtk_message_dialog_new(
       nullptr,
       GTK_DIALOG_MODAL,
@@ -295,6 +456,52 @@ static void show_message_dialog(const gchar* title, const gchar* message, gboole
   gtk_widget_destroy(dialog);
 }
 
+// State of a non-blocking notice, freed when the dialog responds.
+struct AsyncNotice {
+  GtkWidget* dialog;
+  guint timeout_id;
+};
+
+static void async_notice_response_cb(GtkDialog* dialog, gint response_id, gpointer user_data) {
+  AsyncNotice* notice = static_cast<AsyncNotice*>(user_data);
+  if (notice->timeout_id != 0) g_source_remove(notice->timeout_id);
+  gtk_widget_destroy(notice->dialog);
+  delete notice;
+
+  // The duplicate has nothing left to do once the notice is gone.
+  GApplication* app = g_application_get_default();
+  if (app) g_application_quit(app);
+}
+
+static gboolean async_notice_timeout_cb(gpointer user_data) {
+  AsyncNotice* notice = static_cast<AsyncNotice*>(user_data);
+  notice->timeout_id = 0;
+  gtk_dialog_response(GTK_DIALOG(notice->dialog), GTK_RESPONSE_NONE);
+  return G_SOURCE_REMOVE;
+}
+
+// Shows the notice without a nested main loop and returns immediately. The
+// application quits when the dialog is closed, or after timeout_ms when it
+// is positive.
+static void show_message_dialog_async(const gchar* title, const gchar* message,
+                                      int timeout_ms) {
+  GtkWidget* dialog = gtk_message_dialog_new(
+      nullptr,
+      GTK_DIALOG_MODAL,
+      GTK_MESSAGE_INFO,
+      GTK_BUTTONS_OK,
+      "%s", message);
+  gtk_window_set_title(GTK_WINDOW(dialog), title);
+
+  AsyncNotice* notice = new AsyncNotice{dialog, 0};
+  g_signal_connect(dialog, "response", G_CALLBACK(async_notice_response_cb), notice);
+  if (timeout_ms > 0) {
+    notice->timeout_id = g_timeout_add(static_cast<guint>(timeout_ms),
+                                       async_notice_timeout_cb, notice);
+  }
+  gtk_widget_show(dialog);
+}
+
 // ============================================================
 // Message utilities
 // ============================================================
@@ -328,34 +535,969 @@ static void notify_already_running(const gchar* type, const gchar* custom_title,
   show_message_dialog(title, message, show_message_box);
 }
 
+// If the owner named by attempt is verifiably another copy of us, forwards
+// our launch details to it and activates its window. Returns false when the
+// caller should show the "already running" notice instead. Does no UI work,
+// so it may run off the main thread.
+static bool forward_to_running_instance(const LockAttempt& attempt,
+                                        const gchar* lock_file_name,
+                                        const flutter_alone::LaunchRequest& launch,
+                                        int activation_timeout_ms,
+                                        CheckDiagnostics* diagnostics) {
+  flutter_alone::ProcessHandle owner = flutter_alone::verify_lock_owner(attempt, diagnostics);
+  if (!owner.valid()) return false;
+
+  // Best-effort: owners built with older plugin versions have no endpoint.
+  // An owner that raised itself with our activation token needs nothing
+  // more; that is the only way to activate it on native Wayland.
+  uint8_t ack;
+  {
+    ScopedPhase phase(diagnostics, "forwardLaunch");
+    ack = flutter_alone::send_launch_request(lock_file_name, attempt.owner_slot, launch,
+                                             owner.pid());
+  }
+  diagnostics->forwarded = ack != flutter_alone::kLaunchAckNone;
+  if (ack == flutter_alone::kLaunchAckActivated) {
+    diagnostics->activation_backend = "activationToken";
+    diagnostics->activation_succeeded = true;
+    return true;
+  }
+  if (ack == flutter_alone::kLaunchAckCoalesced) {
+    diagnostics->activation_backend = "coalesced";
+    diagnostics->activation_succeeded = true;
+    return true;
+  }
+  if (!owner.IsAlive()) return false;
+  diagnostics->activation_succeeded = activate_existing_window(
+      owner.pid(), attempt.owner_window, activation_timeout_ms, diagnostics);
+  return diagnostics->activation_succeeded;
+}
+
 // ============================================================
-// Lock cleanup helper (shared between dispose handler and GObject dispose)
+// Launch forwarding endpoint (primary side)
 // ============================================================
 
-static void release_lock(FlutterAlonePlugin* self) {
-  if (self->lock_fd >= 0) {
-    if (flock(self->lock_fd, LOCK_UN) != 0) {
-      g_warning("flutter_alone: flock LOCK_UN failed: errno %d", errno);
+// One connection from a rejected instance, kept alive across async reads.
+struct LaunchConnection {
+  FlutterAlonePlugin* plugin;
+  GSocketConnection* connection;
+  pid_t pid;
+  char header[flutter_alone::kLaunchFrameHeaderSize];
+  // Announced payload length, and whether the payload comes in a memfd
+  // instead of inline.
+  uint32_t payload_length;
+  bool payload_in_memfd;
+  std::vector<char> payload;
+  flutter_alone::LaunchRequest request;
+  // Waits for the fds that follow the frame, and gives up on a peer that
+  // stalls before sending them; null and 0 otherwise.
+  GSource* fds_source;
+  guint fds_timeout_id;
+  guint8 ack;
+};
+
+static void launch_connection_free(LaunchConnection* conn) {
+  flutter_alone::close_launch_files(&conn->request);
+  g_io_stream_close(G_IO_STREAM(conn->connection), nullptr, nullptr);
+  g_object_unref(conn->connection);
+  g_object_unref(conn->plugin);
+  delete conn;
+}
+
+static FlValue* launch_request_to_value(const flutter_alone::LaunchRequest& request, pid_t pid,
+                                        bool activated) {
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(value, "timestamp", fl_value_new_int(flutter_alone::current_time_ms()));
+  fl_value_set_string_take(value, "pid", fl_value_new_int(pid));
+  fl_value_set_string_take(value, "activated", fl_value_new_bool(activated));
+  fl_value_set_string_take(value, "workingDirectory",
+                           fl_value_new_string(request.working_directory.c_str()));
+
+  FlValue* arguments = fl_value_new_list();
+  for (const std::string& arg : request.arguments) {
+    fl_value_append_take(arguments, fl_value_new_string(arg.c_str()));
+  }
+  fl_value_set_string_take(value, "arguments", arguments);
+
+  FlValue* environment = fl_value_new_map();
+  for (const std::string& entry : request.environment) {
+    size_t eq = entry.find('=');
+    if (eq == std::string::npos) continue;
+    fl_value_set_string_take(environment, entry.substr(0, eq).c_str(),
+                             fl_value_new_string(entry.c_str() + eq + 1));
+  }
+  fl_value_set_string_take(value, "environment", environment);
+
+  FlValue* files = fl_value_new_list();
+  for (const flutter_alone::LaunchFile& file : request.files) {
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "argumentIndex",
+                             file.argument_index == flutter_alone::kLaunchFileStdin
+                                 ? fl_value_new_null() : fl_value_new_int(file.argument_index));
+    fl_value_set_string_take(entry, "fd", fl_value_new_int(file.fd));
+    g_autofree gchar* path = g_strdup_printf("/proc/self/fd/%d", file.fd);
+    fl_value_set_string_take(entry, "path", fl_value_new_string(path));
+    fl_value_append_take(files, entry);
+  }
+  fl_value_set_string_take(value, "files", files);
+  return value;
+}
+
+static void close_launch_file(FlutterAlonePlugin* self, int fd) {
+  if (g_hash_table_remove(self->launch_files, GINT_TO_POINTER(fd))) close(fd);
+}
+
+// Closes the files of a launch event that will never reach Dart.
+static void close_event_files(FlutterAlonePlugin* self, FlValue* event) {
+  for (size_t i = 0; i < fl_value_get_length(event); i++) {
+    FlValue* files = fl_value_lookup_string(fl_value_get_list_value(event, i), "files");
+    if (!files) continue;
+    for (size_t j = 0; j < fl_value_get_length(files); j++) {
+      FlValue* fd = fl_value_lookup_string(fl_value_get_list_value(files, j), "fd");
+      close_launch_file(self, static_cast<int>(fl_value_get_int(fd)));
     }
-    close(self->lock_fd);
-    self->lock_fd = -1;
   }
-  if (self->lock_file_path) {
-    if (unlink(self->lock_file_path) != 0 && errno != ENOENT) {
-      g_warning("flutter_alone: unlink failed for %s: errno %d", self->lock_file_path, errno);
+}
+
+// Presents our top-level window using the secondary's activation token.
+// GTK hands the token to the compositor (xdg_activation_v1 on Wayland,
+// startup-notification timestamp on X11).
+static bool present_with_activation_token(FlutterAlonePlugin* self, const std::string& token) {
+  if (token.empty() || !self->registrar) return false;
+  FlView* view = fl_plugin_registrar_get_view(self->registrar);
+  if (!view) return false;
+  GtkWidget* toplevel = gtk_widget_get_toplevel(GTK_WIDGET(view));
+  if (!GTK_IS_WINDOW(toplevel) || !gtk_widget_get_realized(toplevel)) return false;
+
+  gtk_window_set_startup_id(GTK_WINDOW(toplevel), token.c_str());
+  gtk_window_present(GTK_WINDOW(toplevel));
+  return true;
+}
+
+// Sends a launch event to Dart, or queues it until Dart listens.
+static void emit_launch_event(FlutterAlonePlugin* self, FlValue* event) {
+  if (self->launch_listening && self->launch_channel) {
+    g_autoptr(GError) error = nullptr;
+    if (!fl_event_channel_send(self->launch_channel, event, nullptr, &error)) {
+      g_warning("flutter_alone: failed to send launch event: %s", error->message);
     }
-    g_free(self->lock_file_path);
-    self->lock_file_path = nullptr;
+    return;
   }
+  if (self->pending_launch_events->len >= kMaxPendingLaunchEvents) {
+    close_event_files(self, static_cast<FlValue*>(self->pending_launch_events->pdata[0]));
+    g_ptr_array_remove_index(self->pending_launch_events, 0);
+  }
+  g_ptr_array_add(self->pending_launch_events, fl_value_ref(event));
+}
+
+static FlMethodErrorResponse* launch_listen_cb(FlEventChannel* channel, FlValue* args,
+                                               gpointer user_data) {
+  FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(user_data);
+  self->launch_listening = TRUE;
+  for (guint i = 0; i < self->pending_launch_events->len; i++) {
+    fl_event_channel_send(channel, static_cast<FlValue*>(self->pending_launch_events->pdata[i]),
+                          nullptr, nullptr);
+  }
+  g_ptr_array_set_size(self->pending_launch_events, 0);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* launch_cancel_cb(FlEventChannel* channel, FlValue* args,
+                                               gpointer user_data) {
+  FLUTTER_ALONE_PLUGIN(user_data)->launch_listening = FALSE;
+  return nullptr;
+}
+
+static void launch_ack_written_cb(GObject* source, GAsyncResult* result, gpointer user_data) {
+  LaunchConnection* conn = static_cast<LaunchConnection*>(user_data);
+  g_output_stream_write_all_finish(G_OUTPUT_STREAM(source), result, nullptr, nullptr);
+  launch_connection_free(conn);
+}
+
+// Marks our slot as just activated, so the next rejected launch goes to the
+// least-recently-active instance. Current secondaries already marked it
+// when they picked us; this covers launches from older ones.
+static void touch_lock_slot(FlutterAlonePlugin* self) {
+  if (self->lock_slot < 0 || self->lock_fd < 0) return;
+  flutter_alone::mark_lock_slot_active(self->lock_fd, self->lock_slot);
+}
+
+static void write_launch_ack(LaunchConnection* conn, guint8 ack) {
+  conn->ack = ack;
+  GOutputStream* output = g_io_stream_get_output_stream(G_IO_STREAM(conn->connection));
+  g_output_stream_write_all_async(output, &conn->ack, sizeof(conn->ack), G_PRIORITY_DEFAULT,
+                                  nullptr, launch_ack_written_cb, conn);
+}
+
+// Delivers the collected launches to Dart as one event and activates the
+// window once. The newest activation token is used: its launch is the one
+// the user just started. Without one, only the newest launch is told to
+// activate the window itself; the others are acked as coalesced.
+static void flush_launch_batch(FlutterAlonePlugin* self) {
+  if (self->launch_batch_timer_id) {
+    g_source_remove(self->launch_batch_timer_id);
+    self->launch_batch_timer_id = 0;
+  }
+  GPtrArray* batch = self->launch_batch;
+  if (batch->len == 0) return;
+
+  touch_lock_slot(self);
+  bool activated = false;
+  for (guint i = batch->len; i-- > 0;) {
+    LaunchConnection* conn = static_cast<LaunchConnection*>(batch->pdata[i]);
+    if (!conn->request.activation_token.empty()) {
+      activated = present_with_activation_token(self, conn->request.activation_token);
+      break;
+    }
+  }
+
+  if (self->launch_channel) {
+    g_autoptr(FlValue) event = fl_value_new_list();
+    for (guint i = 0; i < batch->len; i++) {
+      LaunchConnection* conn = static_cast<LaunchConnection*>(batch->pdata[i]);
+      fl_value_append_take(event, launch_request_to_value(conn->request, conn->pid, activated));
+      // Dart owns the files from now on; the rest are closed with conn.
+      for (flutter_alone::LaunchFile& file : conn->request.files) {
+        g_hash_table_add(self->launch_files, GINT_TO_POINTER(file.fd));
+        file.fd = -1;
+      }
+    }
+    emit_launch_event(self, event);
+  }
+
+  for (guint i = 0; i < batch->len; i++) {
+    LaunchConnection* conn = static_cast<LaunchConnection*>(batch->pdata[i]);
+    guint8 ack = activated ? flutter_alone::kLaunchAckActivated
+        : i + 1 == batch->len ? flutter_alone::kLaunchAckDelivered
+        : flutter_alone::kLaunchAckCoalesced;
+    write_launch_ack(conn, ack);
+  }
+  g_ptr_array_set_size(batch, 0);
+}
+
+static gboolean launch_batch_timeout_cb(gpointer user_data) {
+  FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(user_data);
+  self->launch_batch_timer_id = 0;
+  flush_launch_batch(self);
+  return G_SOURCE_REMOVE;
+}
+
+// Queues a fully read launch for delivery.
+static void add_to_launch_batch(LaunchConnection* conn) {
+  // A burst of launches (e.g. a file manager opening many files) wakes Dart
+  // and activates the window once instead of once per launch.
+  FlutterAlonePlugin* self = conn->plugin;
+  g_ptr_array_add(self->launch_batch, conn);
+  if (self->launch_batch_window_ms <= 0 ||
+      static_cast<int>(self->launch_batch->len) >= self->launch_batch_max_size) {
+    flush_launch_batch(self);
+  } else if (!self->launch_batch_timer_id) {
+    self->launch_batch_timer_id =
+        g_timeout_add(self->launch_batch_window_ms, launch_batch_timeout_cb, self);
+  }
+}
+
+// The fds after the frame arrive as one byte of ancillary data, which
+// GInputStream cannot read, so the socket is polled directly.
+static gboolean launch_fds_ready_cb(GSocket* socket, GIOCondition condition,
+                                    gpointer user_data) {
+  LaunchConnection* conn = static_cast<LaunchConnection*>(user_data);
+  std::vector<int> fds;
+  int received = flutter_alone::receive_launch_fds(g_socket_get_fd(socket), &fds);
+  if (received == 0) return G_SOURCE_CONTINUE;
+
+  g_source_remove(conn->fds_timeout_id);
+  conn->fds_timeout_id = 0;
+  g_clear_pointer(&conn->fds_source, g_source_unref);
+  if (received != 1 ||
+      !flutter_alone::attach_launch_fds(&fds, conn->payload_in_memfd, conn->payload_length,
+                                        &conn->request)) {
+    launch_connection_free(conn);
+  } else {
+    add_to_launch_batch(conn);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+// The peer sent its frame but never the fds, nor closed the connection.
+static gboolean launch_fds_timeout_cb(gpointer user_data) {
+  LaunchConnection* conn = static_cast<LaunchConnection*>(user_data);
+  conn->fds_timeout_id = 0;
+  g_source_destroy(conn->fds_source);
+  g_clear_pointer(&conn->fds_source, g_source_unref);
+  launch_connection_free(conn);
+  return G_SOURCE_REMOVE;
+}
+
+static void receive_launch_fds_async(LaunchConnection* conn) {
+  GSocket* socket = g_socket_connection_get_socket(conn->connection);
+  conn->fds_source = g_socket_create_source(socket, G_IO_IN, nullptr);
+  g_source_set_callback(conn->fds_source, G_SOURCE_FUNC(launch_fds_ready_cb), conn, nullptr);
+  g_source_attach(conn->fds_source, nullptr);
+  conn->fds_timeout_id =
+      g_timeout_add_seconds(kLaunchReadTimeoutSeconds, launch_fds_timeout_cb, conn);
+}
+
+static void launch_payload_read_cb(GObject* source, GAsyncResult* result, gpointer user_data) {
+  LaunchConnection* conn = static_cast<LaunchConnection*>(user_data);
+
+  gsize bytes_read = 0;
+  if (!g_input_stream_read_all_finish(G_INPUT_STREAM(source), result, &bytes_read, nullptr) ||
+      bytes_read != conn->payload.size() ||
+      !flutter_alone::decode_launch_request(conn->payload.data(), conn->payload.size(),
+                                            &conn->request)) {
+    launch_connection_free(conn);
+    return;
+  }
+  conn->payload.clear();
+
+  if (conn->request.files.empty()) {
+    add_to_launch_batch(conn);
+  } else {
+    receive_launch_fds_async(conn);
+  }
+}
+
+static void launch_header_read_cb(GObject* source, GAsyncResult* result, gpointer user_data) {
+  LaunchConnection* conn = static_cast<LaunchConnection*>(user_data);
+
+  gsize bytes_read = 0;
+  if (!g_input_stream_read_all_finish(G_INPUT_STREAM(source), result, &bytes_read, nullptr) ||
+      bytes_read != sizeof(conn->header)) {
+    launch_connection_free(conn);
+    return;
+  }
+
+  int64_t length = flutter_alone::parse_launch_frame_header(conn->header,
+                                                            &conn->payload_in_memfd);
+  if (length < 0) {
+    launch_connection_free(conn);
+    return;
+  }
+  conn->payload_length = static_cast<uint32_t>(length);
+  if (conn->payload_in_memfd) {
+    receive_launch_fds_async(conn);
+    return;
+  }
+
+  conn->payload.resize(static_cast<size_t>(length));
+  g_input_stream_read_all_async(G_INPUT_STREAM(source), conn->payload.data(), conn->payload.size(),
+                                G_PRIORITY_DEFAULT, nullptr, launch_payload_read_cb, conn);
+}
+
+static gboolean launch_incoming_cb(GSocketService* service, GSocketConnection* connection,
+                                   GObject* source_object, gpointer user_data) {
+  FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(user_data);
+  GSocket* socket = g_socket_connection_get_socket(connection);
+
+  // Abstract socket names are reachable by every user in the network
+  // namespace, so only accept our own user.
+  g_autoptr(GCredentials) credentials = g_socket_get_credentials(socket, nullptr);
+  if (!credentials || g_credentials_get_unix_user(credentials, nullptr) != getuid()) {
+    return TRUE;
+  }
+
+  g_socket_set_timeout(socket, kLaunchReadTimeoutSeconds);
+
+  LaunchConnection* conn = new LaunchConnection();
+  conn->plugin = FLUTTER_ALONE_PLUGIN(g_object_ref(self));
+  conn->connection = G_SOCKET_CONNECTION(g_object_ref(connection));
+  conn->pid = g_credentials_get_unix_pid(credentials, nullptr);
+
+  GInputStream* input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+  g_input_stream_read_all_async(input, conn->header, sizeof(conn->header), G_PRIORITY_DEFAULT,
+                                nullptr, launch_header_read_cb, conn);
+  return TRUE;
+}
+
+// Starts serving the pending launch_fd on the main context.
+static void start_launch_service(FlutterAlonePlugin* self) {
+  if (self->launch_fd < 0 || self->launch_service) return;
+
+  g_autoptr(GError) error = nullptr;
+  // The GSocket takes ownership of the fd.
+  g_autoptr(GSocket) socket = g_socket_new_from_fd(self->launch_fd, &error);
+  if (!socket) {
+    g_warning("flutter_alone: failed to adopt launch endpoint: %s", error->message);
+    close(self->launch_fd);
+    self->launch_fd = -1;
+    return;
+  }
+  self->launch_fd = -1;
+
+  self->launch_service = g_socket_service_new();
+  if (!g_socket_listener_add_socket(G_SOCKET_LISTENER(self->launch_service), socket,
+                                    nullptr, &error)) {
+    g_warning("flutter_alone: failed to serve launch endpoint: %s", error->message);
+    g_clear_object(&self->launch_service);
+    return;
+  }
+  g_signal_connect(self->launch_service, "incoming", G_CALLBACK(launch_incoming_cb), self);
+  g_socket_service_start(self->launch_service);
+}
+
+static void stop_launch_service(FlutterAlonePlugin* self) {
+  // Undelivered launches get no ack and fall back to the notice.
+  if (self->launch_batch_timer_id) {
+    g_source_remove(self->launch_batch_timer_id);
+    self->launch_batch_timer_id = 0;
+  }
+  if (self->launch_batch) {
+    for (guint i = 0; i < self->launch_batch->len; i++) {
+      launch_connection_free(static_cast<LaunchConnection*>(self->launch_batch->pdata[i]));
+    }
+    g_ptr_array_set_size(self->launch_batch, 0);
+  }
+  if (self->launch_service) {
+    g_socket_service_stop(self->launch_service);
+    g_socket_listener_close(G_SOCKET_LISTENER(self->launch_service));
+    g_clear_object(&self->launch_service);
+  }
+  if (self->launch_fd >= 0) {
+    close(self->launch_fd);
+    self->launch_fd = -1;
+  }
+}
+
+// Binds the launch endpoint once we own the lock. Failure only disables
+// forwarding; the lock itself stays valid.
+static int open_launch_endpoint(const gchar* lock_file_name, int slot) {
+  int fd = flutter_alone::create_launch_listener(lock_file_name, slot);
+  if (fd < 0) {
+    g_warning("flutter_alone: launch endpoint unavailable: errno %d", errno);
+  }
+  return fd;
+}
+
+// Accepts and drops owner queries on the lock socket so they cannot fill
+// its backlog.
+static gboolean lock_socket_drain_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  int client;
+  while ((client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) close(client);
+  return G_SOURCE_CONTINUE;
+}
+
+static void start_lock_drain(FlutterAlonePlugin* self) {
+  if (self->lock_mode != LockMode::kSocket || self->lock_fd < 0 || self->lock_drain_id) return;
+  self->lock_drain_id = g_unix_fd_add(self->lock_fd, G_IO_IN, lock_socket_drain_cb, nullptr);
+}
+
+// ============================================================
+// Instance registry
+// ============================================================
+
+// Publishes this process as a lock holder. Returns the entry index, or -1;
+// the registry only speeds up lookups, so failure is not an error.
+static int register_lock_holder(flutter_alone::InstanceRegistry* registry,
+                                const std::string& lock_file_name, int slot,
+                                bool accepts_launches) {
+  int index = flutter_alone::register_instance(registry, lock_file_name, slot, accepts_launches);
+  if (registry && index < 0) g_warning("flutter_alone: instance registry is full");
+  return index;
+}
+
+static void unregister_instance(flutter_alone::InstanceRegistry* registry, int index) {
+  if (registry && index >= 0) registry->Unregister(index);
+  delete registry;
+}
+
+static FlValue* instance_info_to_value(const flutter_alone::InstanceInfo& info) {
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(value, "pid", fl_value_new_int(info.pid));
+  fl_value_set_string_take(value, "startTime",
+                           fl_value_new_int(static_cast<int64_t>(info.start_time)));
+  fl_value_set_string_take(value, "windowId", info.window_id
+      ? fl_value_new_int(static_cast<int64_t>(info.window_id)) : fl_value_new_null());
+  fl_value_set_string_take(value, "primary",
+      fl_value_new_bool(info.flags & flutter_alone::kInstanceFlagPrimary));
+  fl_value_set_string_take(value, "acceptsLaunches",
+      fl_value_new_bool(info.flags & flutter_alone::kInstanceFlagAcceptsLaunches));
+  fl_value_set_string_take(value, "slot", info.slot >= 0
+      ? fl_value_new_int(info.slot) : fl_value_new_null());
+  fl_value_set_string_take(value, "endpoint", fl_value_new_string(info.endpoint.c_str()));
+  return value;
+}
+
+// ============================================================
+// Window publication (primary side)
+// ============================================================
+
+#ifdef HAVE_X11
+
+// XID of the realized top-level window containing widget, or 0 (also on
+// non-X11 GDK backends).
+static guint64 get_toplevel_xid(GtkWidget* widget) {
+  GtkWidget* toplevel = gtk_widget_get_toplevel(widget);
+  if (!GTK_IS_WINDOW(toplevel) || !gtk_widget_get_realized(toplevel)) return 0;
+  GdkWindow* window = gtk_widget_get_window(toplevel);
+  if (!GDK_IS_X11_WINDOW(window)) return 0;
+  return gdk_x11_window_get_xid(window);
+}
+
+// Records our window in the lock record and registry, so rejected launches
+// can validate and activate it directly instead of searching for it.
+static void publish_window(FlutterAlonePlugin* self, guint64 window) {
+  if (self->lock_fd < 0 || window == 0 || window == self->lock_window) return;
+  self->lock_window = window;
+  if (self->lock_slot >= 0) {
+    // Keep the activation time the slot already has.
+    flutter_alone::LockSlotRecord record =
+        flutter_alone::read_lock_slots(self->lock_fd, self->lock_slot + 1)[self->lock_slot];
+    record.pid = getpid();
+    record.window_id = window;
+    flutter_alone::write_lock_slot(self->lock_fd, self->lock_slot, record, false);
+  } else if (self->lock_record) {
+    flutter_alone::set_lock_record_window(self->lock_record, window);
+  }
+  if (self->registry) self->registry->SetWindow(self->registry_index, window);
+}
+
+static void view_realize_cb(GtkWidget* view, gpointer user_data) {
+  FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(user_data);
+  g_signal_handler_disconnect(view, self->view_realize_id);
+  self->view_realize_id = 0;
+  publish_window(self, get_toplevel_xid(view));
+}
+
+#endif  // HAVE_X11
+
+// Publishes our window once we hold the lock: right away when the view is
+// already realized, otherwise from its "realize" handler (the top-level
+// window is realized before its children).
+static void start_window_publication(FlutterAlonePlugin* self) {
+#ifdef HAVE_X11
+  if (self->lock_fd < 0 || self->lock_window || self->view_realize_id || !self->registrar) {
+    return;
+  }
+  FlView* view = fl_plugin_registrar_get_view(self->registrar);
+  if (!view) return;
+  if (gtk_widget_get_realized(GTK_WIDGET(view))) {
+    publish_window(self, get_toplevel_xid(GTK_WIDGET(view)));
+    return;
+  }
+  self->view_realize_id = g_signal_connect_object(view, "realize", G_CALLBACK(view_realize_cb),
+                                                  self, G_CONNECT_AFTER);
+#endif
+}
+
+// ============================================================
+// Standby window
+// ============================================================
+
+// The app may show its window after checkAndRun, e.g. on the first frame;
+// a standby keeps it hidden.
+static void standby_window_show_cb(GtkWidget* window, gpointer user_data) {
+  gtk_widget_hide(window);
+}
+
+// Stops waiting for the lock. show_window brings the hidden window back,
+// for a standby that took over or was superseded by another checkAndRun.
+static void stop_standby(FlutterAlonePlugin* self, bool show_window) {
+  StandbyWatch* standby = self->standby;
+  if (!standby) return;
+  self->standby = nullptr;
+  if (standby->owner_watch_id) g_source_remove(standby->owner_watch_id);
+  if (standby->file_watch_id) g_source_remove(standby->file_watch_id);
+  if (standby->file_watch_fd >= 0) close(standby->file_watch_fd);
+  if (standby->recheck_id) g_source_remove(standby->recheck_id);
+  if (standby->window) {
+    g_signal_handler_disconnect(standby->window, standby->show_handler_id);
+    if (show_window) {
+      gtk_widget_show(standby->window);
+      gtk_window_present(GTK_WINDOW(standby->window));
+    }
+    g_object_unref(standby->window);
+  }
+  delete standby;
+}
+
+// ============================================================
+// Lock cleanup helper (shared between dispose handler and GObject dispose)
+// ============================================================
+
+static void release_lock(FlutterAlonePlugin* self) {
+  if (self->check_cancellable) g_cancellable_cancel(self->check_cancellable);
+  stop_standby(self, false);
+  stop_launch_service(self);
+  if (self->lock_drain_id) {
+    g_source_remove(self->lock_drain_id);
+    self->lock_drain_id = 0;
+  }
+  if (!flutter_alone::release_instance_lock(self->lock_mode,
+                                            self->lock_file_path ? self->lock_file_path : "",
+                                            self->lock_fd, self->lock_slot, self->lock_record)) {
+    g_warning("flutter_alone: unlink failed for %s: errno %d", self->lock_file_path, errno);
+  }
+  self->lock_record = nullptr;
+  self->lock_fd = -1;
+  self->lock_slot = -1;
+  self->lock_window = 0;
+  unregister_instance(self->registry, self->registry_index);
+  self->registry = nullptr;
+  self->registry_index = -1;
+  g_clear_pointer(&self->lock_file_path, g_free);
+  g_clear_pointer(&self->lock_filesystem, g_free);
+  self->lock_synced = FALSE;
 }
 
 // ============================================================
 // Method call handler
 // ============================================================
 
+// Inputs and results of one checkAndRun, shared with its worker thread.
+struct CheckTask {
+  LockTarget target;
+  std::string type;
+  std::string custom_title;
+  std::string custom_message;
+  gboolean show_message_box;
+  gboolean non_blocking_message_box;
+  int message_box_timeout_ms;
+  int activation_timeout_ms;
+  // How long to wait for a held lock to be released, or 0 to try once.
+  int wait_for_lock_ms;
+  // Stay running as a standby instead of forwarding the launch.
+  gboolean standby;
+  // Pass argument files and stdin along with a forwarded launch.
+  gboolean forward_files;
+  gboolean forward_stdin;
+  std::vector<std::string> forwarded_environment;
+
+  // Written by the worker.
+  LockAttempt attempt;
+  bool forwarded = false;
+  int launch_fd = -1;
+  std::unique_ptr<flutter_alone::InstanceRegistry> registry;
+  int registry_index = -1;
+  // Completed on the main thread by check_and_run_done().
+  CheckDiagnostics diagnostics;
+};
+
+static void check_task_free(gpointer data) {
+  delete static_cast<CheckTask*>(data);
+}
+
+// Opens the launch endpoint and registers us once the worker holds the
+// lock.
+static void setup_lock_holder(CheckTask* data) {
+  {
+    ScopedPhase phase(&data->diagnostics, "openEndpoint");
+    data->launch_fd = open_launch_endpoint(data->target.name.c_str(), data->attempt.slot);
+  }
+  ScopedPhase phase(&data->diagnostics, "registerInstance");
+  data->registry_index = register_lock_holder(data->registry.get(), data->target.name,
+                                              data->attempt.slot, data->launch_fd >= 0);
+}
+
+// Runs everything that may block: lock file I/O, fdatasync, /proc reads,
+// forwarding, X11 round trips and the xdotool fallback.
+static void check_and_run_worker(GTask* task, gpointer source_object, gpointer task_data,
+                                 GCancellable* cancellable) {
+  CheckTask* data = static_cast<CheckTask*>(task_data);
+  CheckDiagnostics* diagnostics = &data->diagnostics;
+
+  if (data->wait_for_lock_ms > 0) {
+    // Polled with the owner, so dispose stops the wait right away.
+    int cancel_fd = cancellable ? g_cancellable_get_fd(cancellable) : -1;
+    data->attempt = flutter_alone::wait_for_lock(data->target, data->wait_for_lock_ms,
+                                                 cancel_fd, diagnostics);
+    if (cancel_fd >= 0) g_cancellable_release_fd(cancellable);
+  } else {
+    data->attempt = flutter_alone::try_acquire_lock(data->target, diagnostics);
+  }
+  {
+    ScopedPhase phase(diagnostics, "registryOpen");
+    data->registry = flutter_alone::InstanceRegistry::Open(data->target.name);
+  }
+  if (data->attempt.status == LockStatus::kHeldByOther && !data->standby) {
+    {
+      ScopedPhase phase(diagnostics, "registryLookup");
+      flutter_alone::find_lock_owner(data->registry.get(), data->target, &data->attempt);
+    }
+    flutter_alone::LaunchRequest launch =
+        flutter_alone::make_current_launch_request(nullptr, data->forwarded_environment);
+    flutter_alone::open_launch_files(&launch, data->forward_files, data->forward_stdin);
+    data->forwarded = forward_to_running_instance(data->attempt, data->target.name.c_str(),
+                                                  launch, data->activation_timeout_ms,
+                                                  diagnostics);
+    flutter_alone::close_launch_files(&launch);
+  } else if (data->attempt.status == LockStatus::kAcquired) {
+    setup_lock_holder(data);
+  }
+  g_task_return_boolean(task, TRUE);
+}
+
+// Drops anything a worker acquired for a check that was cancelled.
+static void drop_task_lock(CheckTask* data) {
+  if (data->launch_fd >= 0) close(data->launch_fd);
+  if (data->registry && data->registry_index >= 0) {
+    data->registry->Unregister(data->registry_index);
+  }
+  if (data->attempt.status == LockStatus::kAcquired) {
+    flutter_alone::release_instance_lock(data->target.mode, data->target.path, data->attempt.fd,
+                                         data->attempt.slot, data->attempt.record);
+  }
+}
+
+// Keeps the lock a worker acquired for the lifetime of the plugin.
+static void adopt_task_lock(FlutterAlonePlugin* self, CheckTask* data) {
+  const LockAttempt& attempt = data->attempt;
+  self->lock_fd = attempt.fd;
+  self->lock_mode = data->target.mode;
+  self->lock_record = attempt.record;
+  g_free(self->lock_file_path);
+  self->lock_file_path = g_strdup(data->target.path.c_str());
+  if (data->target.mode == LockMode::kFile) {
+    self->lock_filesystem = g_strdup(attempt.filesystem.c_str());
+    self->lock_synced = attempt.synced;
+  }
+  self->lock_slot = attempt.slot;
+  self->launch_fd = data->launch_fd;
+  self->registry = data->registry.release();
+  self->registry_index = data->registry_index;
+  start_lock_drain(self);
+  start_launch_service(self);
+  start_window_publication(self);
+}
+
+// ============================================================
+// Standby takeover
+// ============================================================
+
+static void standby_takeover_done(GObject* source, GAsyncResult* result, gpointer user_data);
+
+static void standby_takeover_worker(GTask* task, gpointer source_object, gpointer task_data,
+                                    GCancellable* cancellable) {
+  CheckTask* data = static_cast<CheckTask*>(task_data);
+  data->attempt = flutter_alone::try_acquire_lock(data->target, &data->diagnostics);
+  if (data->attempt.status == LockStatus::kAcquired) {
+    {
+      ScopedPhase phase(&data->diagnostics, "registryOpen");
+      data->registry = flutter_alone::InstanceRegistry::Open(data->target.name);
+    }
+    setup_lock_holder(data);
+  }
+  g_task_return_boolean(task, TRUE);
+}
+
+// Retries the lock on a worker thread, like checkAndRun. Diagnostics start
+// here, so the promoted check measures the failover after the owner's exit
+// was noticed.
+static void start_standby_takeover(FlutterAlonePlugin* self) {
+  if (!self->standby) return;
+  if (self->check_cancellable) {
+    self->standby->retry_pending = true;
+    return;
+  }
+  self->standby->retry_pending = false;
+  // Watched before the attempt, so a release right after it still wakes
+  // us, and re-added because a new owner may have created a new file.
+  if (self->standby->file_watch_fd >= 0) {
+    inotify_add_watch(self->standby->file_watch_fd, self->standby->target.path.c_str(),
+                      IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+  }
+  CheckTask* data = new CheckTask();
+  data->target = self->standby->target;
+
+  self->check_cancellable = g_cancellable_new();
+  GTask* task = g_task_new(self, self->check_cancellable, standby_takeover_done, nullptr);
+  g_task_set_task_data(task, data, check_task_free);
+  g_task_run_in_thread(task, standby_takeover_worker);
+  g_object_unref(task);
+}
+
+static gboolean standby_owner_exit_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(user_data);
+  self->standby->owner_watch_id = 0;
+  start_standby_takeover(self);
+  return G_SOURCE_REMOVE;
+}
+
+// The lock file was unlinked or replaced: the owner may have released it.
+static gboolean standby_file_event_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  char events[4096];
+  while (read(fd, events, sizeof(events)) > 0) {}
+  start_standby_takeover(FLUTTER_ALONE_PLUGIN(user_data));
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean standby_recheck_cb(gpointer user_data) {
+  start_standby_takeover(FLUTTER_ALONE_PLUGIN(user_data));
+  return G_SOURCE_CONTINUE;
+}
+
+// Waits on the owner named by attempt. The recheck timer runs only while
+// nothing reports the lock becoming free: no pidfd (owner unknown, already
+// gone, or no pidfd_open), or a slot lock, where any other slot owner
+// exiting frees a slot.
+static void watch_standby_owner(FlutterAlonePlugin* self, const LockAttempt& attempt) {
+  StandbyWatch* standby = self->standby;
+  if (!standby->owner_watch_id || standby->owner.pid() != attempt.owner_pid) {
+    if (standby->owner_watch_id) {
+      g_source_remove(standby->owner_watch_id);
+      standby->owner_watch_id = 0;
+    }
+    standby->owner = attempt.owner_pid > 0
+        ? flutter_alone::ProcessHandle::Open(attempt.owner_pid, attempt.owner_start_time)
+        : flutter_alone::ProcessHandle();
+    if (standby->owner.fd() >= 0) {
+      standby->owner_watch_id =
+          g_unix_fd_add(standby->owner.fd(), G_IO_IN, standby_owner_exit_cb, self);
+    }
+  }
+
+  bool recheck = !standby->owner_watch_id || standby->target.max_instances > 1;
+  if (recheck && !standby->recheck_id) {
+    standby->recheck_id = g_timeout_add(kStandbyRecheckMs, standby_recheck_cb, self);
+  } else if (!recheck && standby->recheck_id) {
+    g_source_remove(standby->recheck_id);
+    standby->recheck_id = 0;
+  }
+}
+
+// Keeps a rejected instance running with its window hidden until the lock
+// is free.
+static void enter_standby(FlutterAlonePlugin* self, const LockTarget& target,
+                          const LockAttempt& attempt) {
+  StandbyWatch* standby = new StandbyWatch();
+  standby->target = target;
+  self->standby = standby;
+
+  FlView* view = self->registrar ? fl_plugin_registrar_get_view(self->registrar) : nullptr;
+  GtkWidget* window = view ? gtk_widget_get_toplevel(GTK_WIDGET(view)) : nullptr;
+  if (window && GTK_IS_WINDOW(window)) {
+    standby->window = GTK_WIDGET(g_object_ref(window));
+    gtk_widget_hide(window);
+    standby->show_handler_id =
+        g_signal_connect_after(window, "show", G_CALLBACK(standby_window_show_cb), nullptr);
+  }
+
+  if (target.mode == LockMode::kFile && target.max_instances <= 1) {
+    standby->file_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (standby->file_watch_fd >= 0) {
+      standby->file_watch_id =
+          g_unix_fd_add(standby->file_watch_fd, G_IO_IN, standby_file_event_cb, self);
+    }
+  }
+  watch_standby_owner(self, attempt);
+  // The check's attempt ran before the file was watched; retry once so a
+  // release in between is not missed.
+  if (standby->file_watch_fd >= 0) start_standby_takeover(self);
+}
+
+// Back on the main thread: takes over, or goes back to waiting on whoever
+// holds the lock now.
+static void standby_takeover_done(GObject* source, GAsyncResult* result, gpointer user_data) {
+  FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(source);
+  CheckTask* data = static_cast<CheckTask*>(g_task_get_task_data(G_TASK(result)));
+  bool cancelled = g_cancellable_is_cancelled(g_task_get_cancellable(G_TASK(result)));
+  g_clear_object(&self->check_cancellable);
+
+  const LockAttempt& attempt = data->attempt;
+  if (cancelled || !self->standby) {
+    drop_task_lock(data);
+  } else if (attempt.status == LockStatus::kHeldByOther) {
+    watch_standby_owner(self, attempt);
+    if (self->standby->retry_pending) start_standby_takeover(self);
+  } else if (attempt.status == LockStatus::kError) {
+    g_warning("flutter_alone: standby could not take over %s: %s", data->target.path.c_str(),
+              attempt.error_message);
+    // Nothing may report the next chance; fall back to retrying.
+    if (!self->standby->recheck_id) {
+      self->standby->recheck_id = g_timeout_add(kStandbyRecheckMs, standby_recheck_cb, self);
+    }
+  } else {
+    adopt_task_lock(self, data);
+    stop_standby(self, true);
+    finish_check_diagnostics(std::move(data->diagnostics), "promoted");
+    if (self->channel) {
+      fl_method_channel_invoke_method(self->channel, kMethodOnPromoted, nullptr, nullptr,
+                                      nullptr, nullptr);
+    }
+  }
+}
+
+// Back on the main thread: adopts the lock or shows the notice, then
+// responds.
+static void check_and_run_done(GObject* source, GAsyncResult* result, gpointer user_data) {
+  FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(source);
+  FlMethodCall* method_call = FL_METHOD_CALL(user_data);
+  CheckTask* data = static_cast<CheckTask*>(g_task_get_task_data(G_TASK(result)));
+  bool cancelled = g_cancellable_is_cancelled(g_task_get_cancellable(G_TASK(result)));
+  g_clear_object(&self->check_cancellable);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  const LockAttempt& attempt = data->attempt;
+
+  if (cancelled) {
+    // Disposed while the worker ran: drop anything it acquired.
+    drop_task_lock(data);
+    response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "CANCELLED", "Plugin was disposed during checkAndRun", nullptr));
+    finish_check_diagnostics(std::move(data->diagnostics), "cancelled");
+
+  } else if (attempt.status == LockStatus::kError) {
+    response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "IO_ERROR", attempt.error_message, nullptr));
+    finish_check_diagnostics(std::move(data->diagnostics), "error");
+
+  } else if (attempt.status == LockStatus::kHeldByOther) {
+    g_autoptr(FlValue) value = fl_value_new_bool(FALSE);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(value));
+
+    if (data->standby) {
+      enter_standby(self, data->target, attempt);
+      finish_check_diagnostics(std::move(data->diagnostics), "alreadyRunning");
+      fl_method_call_respond(method_call, response, nullptr);
+      g_object_unref(method_call);
+      return;
+    }
+
+    bool show_notice = !data->forwarded && data->show_message_box;
+    if (show_notice && data->non_blocking_message_box) {
+      // Answer first so Dart can tear down while the notice is up.
+      fl_method_call_respond(method_call, response, nullptr);
+      g_object_unref(method_call);
+      {
+        ScopedPhase phase(&data->diagnostics, "dialog");
+        show_message_dialog_async(
+            get_title_for_type(data->type.c_str(), data->custom_title.c_str()),
+            get_message_for_type(data->type.c_str(), data->custom_message.c_str()),
+            data->message_box_timeout_ms);
+      }
+      finish_check_diagnostics(std::move(data->diagnostics), "alreadyRunning");
+      return;
+    }
+    if (show_notice) {
+      ScopedPhase phase(&data->diagnostics, "dialog");
+      notify_already_running(data->type.c_str(), data->custom_title.c_str(),
+                             data->custom_message.c_str(), TRUE);
+    }
+    finish_check_diagnostics(std::move(data->diagnostics), "alreadyRunning");
+
+  } else {
+    // Keep fd open for the lifetime of the plugin
+    adopt_task_lock(self, data);
+    finish_check_diagnostics(std::move(data->diagnostics), "acquired");
+
+    g_autoptr(FlValue) value = fl_value_new_bool(TRUE);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(value));
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+  g_object_unref(method_call);
+}
+
 static void handle_check_and_run(FlutterAlonePlugin* self, FlValue* args, FlMethodCall* method_call) {
   g_autoptr(FlMethodResponse) response = nullptr;
 
+  if (self->check_cancellable) {
+    response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "IN_PROGRESS", "checkAndRun is already in progress", nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
   // Get lockFileName
   FlValue* lock_file_value = fl_value_lookup_string(args, "lockFileName");
   if (!lock_file_value || fl_value_get_type(lock_file_value) == FL_VALUE_TYPE_NULL) {
@@ -367,10 +1509,7 @@ static void handle_check_and_run(FlutterAlonePlugin* self, FlValue* args, FlMeth
   const gchar* lock_file_name = fl_value_get_string(lock_file_value);
 
   // Validate lockFileName: no path separators, not empty, not "." or ".."
-  if (strchr(lock_file_name, '/') != nullptr ||
-      strlen(lock_file_name) == 0 ||
-      strcmp(lock_file_name, ".") == 0 ||
-      strcmp(lock_file_name, "..") == 0) {
+  if (!flutter_alone::is_valid_lock_file_name(lock_file_name)) {
     response = FL_METHOD_RESPONSE(fl_method_error_response_new(
         "INVALID_ARGUMENT", "lockFileName must be a simple filename without path separators", nullptr));
     fl_method_call_respond(method_call, response, nullptr);
@@ -392,59 +1531,193 @@ static void handle_check_and_run(FlutterAlonePlugin* self, FlValue* args, FlMeth
   const gchar* custom_message = (custom_message_value && fl_value_get_type(custom_message_value) != FL_VALUE_TYPE_NULL)
       ? fl_value_get_string(custom_message_value) : "";
 
-  // Build lock file path
-  std::string lock_path = get_lock_file_path(lock_file_name);
+  FlValue* non_blocking_value = fl_value_lookup_string(args, "nonBlockingMessageBox");
+  gboolean non_blocking_message_box =
+      (non_blocking_value && fl_value_get_type(non_blocking_value) == FL_VALUE_TYPE_BOOL)
+          ? fl_value_get_bool(non_blocking_value) : FALSE;
+
+  FlValue* message_box_timeout_value = fl_value_lookup_string(args, "messageBoxTimeoutMs");
+  int message_box_timeout_ms =
+      (message_box_timeout_value && fl_value_get_type(message_box_timeout_value) == FL_VALUE_TYPE_INT)
+          ? static_cast<int>(fl_value_get_int(message_box_timeout_value)) : 0;
+
+  FlValue* activation_timeout_value = fl_value_lookup_string(args, "activationTimeoutMs");
+  int activation_timeout_ms =
+      (activation_timeout_value && fl_value_get_type(activation_timeout_value) == FL_VALUE_TYPE_INT)
+          ? static_cast<int>(fl_value_get_int(activation_timeout_value)) : 0;
+  if (activation_timeout_ms <= 0) activation_timeout_ms = kDefaultActivationTimeoutMs;
+
+  FlValue* wait_for_lock_value = fl_value_lookup_string(args, "waitForLockMs");
+  int wait_for_lock_ms =
+      (wait_for_lock_value && fl_value_get_type(wait_for_lock_value) == FL_VALUE_TYPE_INT)
+          ? static_cast<int>(fl_value_get_int(wait_for_lock_value)) : 0;
+
+  FlValue* batch_window_value = fl_value_lookup_string(args, "launchBatchWindowMs");
+  int launch_batch_window_ms =
+      (batch_window_value && fl_value_get_type(batch_window_value) == FL_VALUE_TYPE_INT)
+          ? static_cast<int>(fl_value_get_int(batch_window_value)) : 0;
+
+  FlValue* batch_max_size_value = fl_value_lookup_string(args, "launchBatchMaxSize");
+  int launch_batch_max_size =
+      (batch_max_size_value && fl_value_get_type(batch_max_size_value) == FL_VALUE_TYPE_INT)
+          ? static_cast<int>(fl_value_get_int(batch_max_size_value)) : 1;
+
+  FlValue* standby_value = fl_value_lookup_string(args, "standby");
+  gboolean standby =
+      (standby_value && fl_value_get_type(standby_value) == FL_VALUE_TYPE_BOOL)
+          ? fl_value_get_bool(standby_value) : FALSE;
+
+  FlValue* forward_files_value = fl_value_lookup_string(args, "forwardFiles");
+  gboolean forward_files =
+      (forward_files_value && fl_value_get_type(forward_files_value) == FL_VALUE_TYPE_BOOL)
+          ? fl_value_get_bool(forward_files_value) : FALSE;
+
+  FlValue* forward_stdin_value = fl_value_lookup_string(args, "forwardStdin");
+  gboolean forward_stdin =
+      (forward_stdin_value && fl_value_get_type(forward_stdin_value) == FL_VALUE_TYPE_BOOL)
+          ? fl_value_get_bool(forward_stdin_value) : FALSE;
+
+  std::vector<std::string> forwarded_environment;
+  FlValue* forwarded_env_value = fl_value_lookup_string(args, "forwardedEnvironment");
+  if (forwarded_env_value && fl_value_get_type(forwarded_env_value) == FL_VALUE_TYPE_LIST) {
+    for (size_t i = 0; i < fl_value_get_length(forwarded_env_value); i++) {
+      FlValue* name = fl_value_get_list_value(forwarded_env_value, i);
+      if (fl_value_get_type(name) == FL_VALUE_TYPE_STRING) {
+        forwarded_environment.emplace_back(fl_value_get_string(name));
+      }
+    }
+  }
 
-  g_free(self->lock_file_path);
-  self->lock_file_path = g_strdup(lock_path.c_str());
+  FlValue* lock_mode_value = fl_value_lookup_string(args, "lockMode");
+  LockMode lock_mode = parse_lock_mode(
+      (lock_mode_value && fl_value_get_type(lock_mode_value) == FL_VALUE_TYPE_STRING)
+          ? fl_value_get_string(lock_mode_value) : nullptr);
 
-  // Open lock file with O_NOFOLLOW to prevent symlink attacks
-  int fd = open(lock_path.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW, 0644);
-  if (fd < 0) {
-    response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "IO_ERROR", "Failed to open lock file", nullptr));
-    fl_method_call_respond(method_call, response, nullptr);
-    return;
-  }
+  FlValue* lock_directory_value = fl_value_lookup_string(args, "lockDirectory");
+  LockDirectory lock_directory = parse_lock_directory(
+      (lock_directory_value && fl_value_get_type(lock_directory_value) == FL_VALUE_TYPE_STRING)
+          ? fl_value_get_string(lock_directory_value) : nullptr);
 
-  // Try to acquire exclusive advisory lock (non-blocking)
-  if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
-    // Read PID from the already-opened fd to avoid re-open TOCTOU
-    pid_t existing_pid = read_pid_from_fd(fd);
-    close(fd);
+  FlValue* lock_directory_path_value = fl_value_lookup_string(args, "lockDirectoryPath");
+  const gchar* lock_directory_path =
+      (lock_directory_path_value && fl_value_get_type(lock_directory_path_value) == FL_VALUE_TYPE_STRING)
+          ? fl_value_get_string(lock_directory_path_value) : nullptr;
 
-    if (existing_pid > 0 && is_process_running(existing_pid) && is_same_executable(existing_pid)) {
-      bool activated = activate_existing_window(existing_pid);
-      if (!activated) {
-        notify_already_running(type, custom_title, custom_message, show_message_box);
-      }
-    } else {
-      notify_already_running(type, custom_title, custom_message, show_message_box);
+  FlValue* max_instances_value = fl_value_lookup_string(args, "maxInstances");
+  int max_instances =
+      (max_instances_value && fl_value_get_type(max_instances_value) == FL_VALUE_TYPE_INT)
+          ? static_cast<int>(fl_value_get_int(max_instances_value)) : 1;
+
+  LockTarget target = flutter_alone::get_lock_target(lock_mode, lock_directory, lock_directory_path,
+                                      lock_file_name, max_instances);
+
+  // Applies to launches served from now on, including by an adopted lock.
+  self->launch_batch_window_ms = CLAMP(launch_batch_window_ms, 0, kMaxLaunchBatchWindowMs);
+  self->launch_batch_max_size = MAX(launch_batch_max_size, 1);
+
+  // Already holding this lock, e.g. adopted from flutter_alone_check_and_run()
+  if (self->lock_fd >= 0) {
+    if (self->lock_file_path && target.path == self->lock_file_path) {
+      start_lock_drain(self);
+      start_launch_service(self);
+      start_window_publication(self);
+      g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+      fl_method_call_respond(method_call, response, nullptr);
+      return;
     }
+    release_lock(self);
+  }
+  // A new check replaces waiting as a standby.
+  stop_standby(self, true);
+
+  CheckTask* data = new CheckTask();
+  data->target = std::move(target);
+  data->type = type;
+  data->custom_title = custom_title;
+  data->custom_message = custom_message;
+  data->show_message_box = show_message_box;
+  data->non_blocking_message_box = non_blocking_message_box;
+  data->message_box_timeout_ms = message_box_timeout_ms;
+  data->activation_timeout_ms = activation_timeout_ms;
+  data->wait_for_lock_ms = wait_for_lock_ms;
+  data->standby = standby;
+  data->forward_files = forward_files;
+  data->forward_stdin = forward_stdin;
+  data->forwarded_environment = std::move(forwarded_environment);
+
+  self->check_cancellable = g_cancellable_new();
+  GTask* task = g_task_new(self, self->check_cancellable, check_and_run_done,
+                           g_object_ref(method_call));
+  g_task_set_task_data(task, data, check_task_free);
+  g_task_run_in_thread(task, check_and_run_worker);
+  g_object_unref(task);
+}
 
-    g_autoptr(FlValue) result = fl_value_new_bool(FALSE);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-    fl_method_call_respond(method_call, response, nullptr);
-    return;
+// Describes the held lock for auditing, or null when none is held.
+static FlValue* get_lock_info(FlutterAlonePlugin* self) {
+  if (self->lock_fd < 0 || !self->lock_file_path) return fl_value_new_null();
+
+  FlValue* info = fl_value_new_map();
+  fl_value_set_string_take(info, "mode", fl_value_new_string(
+      self->lock_mode == LockMode::kSocket ? "socket" : "file"));
+  fl_value_set_string_take(info, "path", fl_value_new_string(self->lock_file_path));
+  if (self->lock_mode == LockMode::kFile) {
+    g_autofree gchar* directory = g_path_get_dirname(self->lock_file_path);
+    fl_value_set_string_take(info, "directory", fl_value_new_string(directory));
+    fl_value_set_string_take(info, "filesystem", self->lock_filesystem
+        ? fl_value_new_string(self->lock_filesystem) : fl_value_new_null());
   }
+  fl_value_set_string_take(info, "synced", fl_value_new_bool(self->lock_synced));
+  fl_value_set_string_take(info, "slot", self->lock_slot >= 0
+      ? fl_value_new_int(self->lock_slot) : fl_value_new_null());
+  return info;
+}
 
-  // We hold the lock. Write our PID.
-  pid_t current_pid = getpid();
-  if (!write_pid_to_fd(fd, current_pid)) {
-    flock(fd, LOCK_UN);
-    close(fd);
-    response = FL_METHOD_RESPONSE(fl_method_error_response_new(
-        "IO_ERROR", "Failed to write PID to lock file", nullptr));
-    fl_method_call_respond(method_call, response, nullptr);
-    return;
+// Describes the most recent check, or null when none has completed.
+static FlValue* get_last_check_diagnostics() {
+  const CheckDiagnostics* diagnostics = g_last_check_diagnostics.get();
+  if (!diagnostics) return fl_value_new_null();
+
+  FlValue* phases = fl_value_new_list();
+  for (const flutter_alone::CheckPhase& phase : diagnostics->phases) {
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "name", fl_value_new_string(phase.name));
+    fl_value_set_string_take(entry, "startUs", fl_value_new_int(phase.start_us));
+    fl_value_set_string_take(entry, "durationUs", fl_value_new_int(phase.duration_us));
+    fl_value_append_take(phases, entry);
   }
 
-  // Keep fd open for the lifetime of the plugin
-  self->lock_fd = fd;
+  FlValue* info = fl_value_new_map();
+  fl_value_set_string_take(info, "outcome", fl_value_new_string(diagnostics->outcome));
+  fl_value_set_string_take(info, "lockMode", fl_value_new_string(
+      diagnostics->lock_mode == LockMode::kSocket ? "socket" : "file"));
+  fl_value_set_string_take(info, "preEngine", fl_value_new_bool(diagnostics->pre_engine));
+  fl_value_set_string_take(info, "totalUs", fl_value_new_int(diagnostics->total_us));
+  fl_value_set_string_take(info, "phases", phases);
+  fl_value_set_string_take(info, "forwarded", fl_value_new_bool(diagnostics->forwarded));
+  fl_value_set_string_take(info, "activationBackend", diagnostics->activation_backend
+      ? fl_value_new_string(diagnostics->activation_backend) : fl_value_new_null());
+  fl_value_set_string_take(info, "activationSucceeded",
+                           fl_value_new_bool(diagnostics->activation_succeeded));
+  return info;
+}
 
-  g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
-  response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  fl_method_call_respond(method_call, response, nullptr);
+// Live entries of the registry for lock_file_name, or of the held lock
+// when it is null.
+static FlValue* list_instances(FlutterAlonePlugin* self, const gchar* lock_file_name) {
+  FlValue* list = fl_value_new_list();
+  std::unique_ptr<flutter_alone::InstanceRegistry> opened;
+  flutter_alone::InstanceRegistry* registry = self->registry;
+  if (lock_file_name) {
+    opened = flutter_alone::InstanceRegistry::Open(lock_file_name);
+    registry = opened.get();
+  }
+  if (!registry) return list;
+  for (const flutter_alone::InstanceInfo& info : registry->List()) {
+    fl_value_append_take(list, instance_info_to_value(info));
+  }
+  return list;
 }
 
 static void flutter_alone_plugin_handle_method_call(
@@ -462,6 +1735,49 @@ static void flutter_alone_plugin_handle_method_call(
     }
     handle_check_and_run(self, args, method_call);
 
+  } else if (strcmp(method, kMethodGetLockInfo) == 0) {
+    g_autoptr(FlValue) result = get_lock_info(self);
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    fl_method_call_respond(method_call, response, nullptr);
+
+  } else if (strcmp(method, kMethodGetLastCheckDiagnostics) == 0) {
+    g_autoptr(FlValue) result = get_last_check_diagnostics();
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    fl_method_call_respond(method_call, response, nullptr);
+
+  } else if (strcmp(method, kMethodListInstances) == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* lock_file_value = (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP)
+        ? fl_value_lookup_string(args, "lockFileName") : nullptr;
+    const gchar* lock_file_name =
+        (lock_file_value && fl_value_get_type(lock_file_value) == FL_VALUE_TYPE_STRING)
+            ? fl_value_get_string(lock_file_value) : nullptr;
+    g_autoptr(FlMethodResponse) response = nullptr;
+    if (lock_file_name && !flutter_alone::is_valid_lock_file_name(lock_file_name)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "lockFileName must be a simple filename without path separators", nullptr));
+    } else {
+      g_autoptr(FlValue) result = list_instances(self, lock_file_name);
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+    fl_method_call_respond(method_call, response, nullptr);
+
+  } else if (strcmp(method, kMethodCloseLaunchFiles) == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* fds_value = (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP)
+        ? fl_value_lookup_string(args, "fds") : nullptr;
+    if (fds_value && fl_value_get_type(fds_value) == FL_VALUE_TYPE_LIST) {
+      for (size_t i = 0; i < fl_value_get_length(fds_value); i++) {
+        FlValue* fd = fl_value_get_list_value(fds_value, i);
+        // Only fds we handed out, so a stale call cannot close anything else.
+        if (fl_value_get_type(fd) == FL_VALUE_TYPE_INT) {
+          close_launch_file(self, static_cast<int>(fl_value_get_int(fd)));
+        }
+      }
+    }
+    g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    fl_method_call_respond(method_call, response, nullptr);
+
   } else if (strcmp(method, kMethodDispose) == 0) {
     release_lock(self);
     g_autoptr(FlMethodResponse) response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
@@ -480,6 +1796,29 @@ static void flutter_alone_plugin_handle_method_call(
 static void flutter_alone_plugin_dispose(GObject* object) {
   FlutterAlonePlugin* self = FLUTTER_ALONE_PLUGIN(object);
   release_lock(self);
+  if (self->channel) {
+    g_object_remove_weak_pointer(G_OBJECT(self->channel),
+                                 reinterpret_cast<gpointer*>(&self->channel));
+    self->channel = nullptr;
+  }
+  if (self->launch_channel) {
+    g_object_remove_weak_pointer(G_OBJECT(self->launch_channel),
+                                 reinterpret_cast<gpointer*>(&self->launch_channel));
+    self->launch_channel = nullptr;
+  }
+  g_clear_pointer(&self->pending_launch_events, g_ptr_array_unref);
+  g_clear_pointer(&self->launch_batch, g_ptr_array_unref);
+  if (self->launch_files) {
+    GHashTableIter iter;
+    gpointer fd;
+    g_hash_table_iter_init(&iter, self->launch_files);
+    while (g_hash_table_iter_next(&iter, &fd, nullptr)) close(GPOINTER_TO_INT(fd));
+    g_clear_pointer(&self->launch_files, g_hash_table_unref);
+  }
+  g_clear_object(&self->registrar);
+#ifdef HAVE_X11
+  close_x11_context();
+#endif
   G_OBJECT_CLASS(flutter_alone_plugin_parent_class)->dispose(object);
 }
 
@@ -488,8 +1827,63 @@ static void flutter_alone_plugin_class_init(FlutterAlonePluginClass* klass) {
 }
 
 static void flutter_alone_plugin_init(FlutterAlonePlugin* self) {
+  // Read our executable identity once, on the main thread, before any
+  // owner check needs it.
+  flutter_alone::get_self_executable();
+#ifdef HAVE_X11
+  g_main_thread = g_thread_self();
+#endif
+
   self->lock_file_path = nullptr;
   self->lock_fd = -1;
+  self->lock_mode = LockMode::kFile;
+  self->lock_filesystem = nullptr;
+  self->lock_synced = FALSE;
+  self->lock_record = nullptr;
+  self->lock_slot = -1;
+  self->lock_window = 0;
+  self->view_realize_id = 0;
+  self->lock_drain_id = 0;
+  self->registry = nullptr;
+  self->registry_index = -1;
+  self->channel = nullptr;
+  self->launch_channel = nullptr;
+  self->launch_listening = FALSE;
+  self->pending_launch_events =
+      g_ptr_array_new_with_free_func(reinterpret_cast<GDestroyNotify>(fl_value_unref));
+  self->launch_fd = -1;
+  self->launch_service = nullptr;
+  self->launch_batch = g_ptr_array_new();
+  self->launch_batch_timer_id = 0;
+  self->launch_batch_window_ms = 0;
+  self->launch_batch_max_size = 1;
+  self->launch_files = g_hash_table_new(g_direct_hash, g_direct_equal);
+  self->registrar = nullptr;
+  self->check_cancellable = nullptr;
+  self->standby = nullptr;
+
+  // Adopt a lock acquired by flutter_alone_check_and_run() before the engine
+  // existed, so it is released through the normal dispose paths.
+  if (g_early_lock_fd >= 0) {
+    self->lock_fd = g_early_lock_fd;
+    self->lock_file_path = g_early_lock_file_path;
+    self->lock_mode = g_early_lock_mode;
+    self->lock_record = g_early_lock_record;
+    self->lock_filesystem = g_early_lock_filesystem;
+    self->lock_synced = g_early_lock_synced;
+    self->lock_slot = g_early_lock_slot;
+    self->launch_fd = g_early_launch_fd;
+    self->registry = g_early_registry;
+    self->registry_index = g_early_registry_index;
+    g_early_lock_fd = -1;
+    g_early_lock_file_path = nullptr;
+    g_early_lock_record = nullptr;
+    g_early_lock_filesystem = nullptr;
+    g_early_lock_slot = -1;
+    g_early_launch_fd = -1;
+    g_early_registry = nullptr;
+    g_early_registry_index = -1;
+  }
 }
 
 static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
@@ -510,6 +1904,137 @@ void flutter_alone_plugin_register_with_registrar(FlPluginRegistrar* registrar)
   fl_method_channel_set_method_call_handler(channel, method_call_cb,
                                             g_object_ref(plugin),
                                             g_object_unref);
+  plugin->channel = channel;
+  g_object_add_weak_pointer(G_OBJECT(channel), reinterpret_cast<gpointer*>(&plugin->channel));
+
+  g_autoptr(FlEventChannel) launch_channel =
+      fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                           kLaunchEventChannelName,
+                           FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(launch_channel, launch_listen_cb, launch_cancel_cb,
+                                       g_object_ref(plugin), g_object_unref);
+  plugin->launch_channel = launch_channel;
+  g_object_add_weak_pointer(G_OBJECT(launch_channel),
+                            reinterpret_cast<gpointer*>(&plugin->launch_channel));
+  plugin->registrar = FL_PLUGIN_REGISTRAR(g_object_ref(registrar));
 
   g_object_unref(plugin);
 }
+
+// ============================================================
+// Pre-engine check and inspection
+// ============================================================
+
+FlutterAloneCheckResult flutter_alone_check_and_run(const FlutterAloneCheckOptions* options) {
+  if (!options || !flutter_alone::is_valid_lock_file_name(options->lock_file_name)) {
+    return FLUTTER_ALONE_CHECK_ERROR;
+  }
+
+  LockMode lock_mode = options->lock_mode == FLUTTER_ALONE_LOCK_MODE_SOCKET
+      ? LockMode::kSocket : LockMode::kFile;
+  LockDirectory lock_directory = options->lock_directory == FLUTTER_ALONE_LOCK_DIRECTORY_RUNTIME
+      ? LockDirectory::kRuntime : LockDirectory::kSystemTemp;
+  LockTarget target = flutter_alone::get_lock_target(lock_mode, lock_directory, options->lock_directory_path,
+                                      options->lock_file_name, options->max_instances);
+
+  if (g_early_lock_fd >= 0) {
+    if (target.path == g_early_lock_file_path) return FLUTTER_ALONE_CHECK_CAN_RUN;
+    return FLUTTER_ALONE_CHECK_ERROR;
+  }
+
+  CheckDiagnostics diagnostics;
+  diagnostics.pre_engine = true;
+  LockAttempt attempt = options->wait_for_lock_ms > 0
+      ? flutter_alone::wait_for_lock(target, options->wait_for_lock_ms, -1, &diagnostics)
+      : flutter_alone::try_acquire_lock(target, &diagnostics);
+  std::unique_ptr<flutter_alone::InstanceRegistry> registry;
+  {
+    ScopedPhase phase(&diagnostics, "registryOpen");
+    registry = flutter_alone::InstanceRegistry::Open(target.name);
+  }
+
+  if (attempt.status == LockStatus::kError) {
+    g_warning("flutter_alone: %s: %s", attempt.error_message, target.path.c_str());
+    finish_check_diagnostics(std::move(diagnostics), "error");
+    return FLUTTER_ALONE_CHECK_ERROR;
+  }
+
+  if (attempt.status == LockStatus::kHeldByOther) {
+    const gchar* type = options->type ? options->type : "en";
+    const gchar* custom_title = options->custom_title ? options->custom_title : "";
+    const gchar* custom_message = options->custom_message ? options->custom_message : "";
+    int activation_timeout_ms = options->activation_timeout_ms > 0
+        ? options->activation_timeout_ms : kDefaultActivationTimeoutMs;
+    std::vector<std::string> forwarded_environment;
+    if (options->forwarded_environment) {
+      for (const gchar* const* name = options->forwarded_environment; *name; ++name) {
+        forwarded_environment.emplace_back(*name);
+      }
+    }
+    {
+      ScopedPhase phase(&diagnostics, "registryLookup");
+      flutter_alone::find_lock_owner(registry.get(), target, &attempt);
+    }
+    flutter_alone::LaunchRequest launch =
+        flutter_alone::make_current_launch_request(options->arguments, forwarded_environment);
+    flutter_alone::open_launch_files(&launch, options->forward_files, options->forward_stdin);
+    bool forwarded = forward_to_running_instance(attempt, options->lock_file_name, launch,
+                                                 activation_timeout_ms, &diagnostics);
+    flutter_alone::close_launch_files(&launch);
+    if (!forwarded) {
+      ScopedPhase phase(&diagnostics, "dialog");
+      notify_already_running(type, custom_title, custom_message, options->show_message_box);
+    }
+    finish_check_diagnostics(std::move(diagnostics), "alreadyRunning");
+    return FLUTTER_ALONE_CHECK_ALREADY_RUNNING;
+  }
+
+  g_early_lock_fd = attempt.fd;
+  g_early_lock_file_path = g_strdup(target.path.c_str());
+  g_early_lock_mode = lock_mode;
+  g_early_lock_record = attempt.record;
+  if (lock_mode == LockMode::kFile) {
+    g_early_lock_filesystem = g_strdup(attempt.filesystem.c_str());
+    g_early_lock_synced = attempt.synced;
+  }
+  g_early_lock_slot = attempt.slot;
+  // Bound now so launches arriving during engine startup queue in the
+  // backlog until the plugin starts serving.
+  {
+    ScopedPhase phase(&diagnostics, "openEndpoint");
+    g_early_launch_fd = open_launch_endpoint(options->lock_file_name, attempt.slot);
+  }
+  {
+    ScopedPhase phase(&diagnostics, "registerInstance");
+    g_early_registry_index = register_lock_holder(registry.get(), target.name, attempt.slot,
+                                                  g_early_launch_fd >= 0);
+  }
+  g_early_registry = registry.release();
+  // checkAndRun later adopts this lock without a check of its own, so
+  // these stay the diagnostics it reports.
+  finish_check_diagnostics(std::move(diagnostics), "acquired");
+  return FLUTTER_ALONE_CHECK_CAN_RUN;
+}
+
+gint flutter_alone_list_instances(const gchar* lock_file_name,
+                                  FlutterAloneInstanceInfo* instances, gint capacity) {
+  if (!flutter_alone::is_valid_lock_file_name(lock_file_name) || capacity < 0 ||
+      (capacity > 0 && !instances)) {
+    return -1;
+  }
+  std::unique_ptr<flutter_alone::InstanceRegistry> registry =
+      flutter_alone::InstanceRegistry::Open(lock_file_name);
+  if (!registry) return -1;
+
+  std::vector<flutter_alone::InstanceInfo> live = registry->List();
+  for (size_t i = 0; i < live.size() && static_cast<gint>(i) < capacity; i++) {
+    FlutterAloneInstanceInfo* out = &instances[i];
+    out->pid = live[i].pid;
+    out->start_time = live[i].start_time;
+    out->window_id = live[i].window_id;
+    out->primary = (live[i].flags & flutter_alone::kInstanceFlagPrimary) != 0;
+    out->accepts_launches = (live[i].flags & flutter_alone::kInstanceFlagAcceptsLaunches) != 0;
+    out->slot = live[i].slot;
+  }
+  return static_cast<gint>(live.size());
+}
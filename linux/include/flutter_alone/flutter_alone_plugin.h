@@ -21,6 +21,109 @@ FLUTTER_PLUGIN_EXPORT GType flutter_alone_plugin_get_type();
 FLUTTER_PLUGIN_EXPORT void flutter_alone_plugin_register_with_registrar(
     FlPluginRegistrar* registrar);
 
+// Result of flutter_alone_check_and_run().
+typedef enum {
+  // This process now holds the lock and should continue starting up.
+  FLUTTER_ALONE_CHECK_CAN_RUN = 0,
+  // Another instance holds the lock. It was activated or the notice was
+  // shown; the caller should exit.
+  FLUTTER_ALONE_CHECK_ALREADY_RUNNING = 1,
+  // The check could not be performed (e.g. invalid name, unwritable lock
+  // file). The caller may continue and let checkAndRun report the error.
+  FLUTTER_ALONE_CHECK_ERROR = 2,
+} FlutterAloneCheckResult;
+
+// Lock backend, matching LinuxConfig.lockMode on the Dart side.
+typedef enum {
+  // flock() on a file in the temp directory.
+  FLUTTER_ALONE_LOCK_MODE_FILE = 0,
+  // Abstract-namespace Unix socket; no filesystem I/O.
+  FLUTTER_ALONE_LOCK_MODE_SOCKET = 1,
+} FlutterAloneLockMode;
+
+// Lock file directory, matching LinuxConfig.lockDirectory on the Dart side.
+typedef enum {
+  // The directory g_get_tmp_dir() returns: $TMPDIR, typically /tmp.
+  FLUTTER_ALONE_LOCK_DIRECTORY_SYSTEM_TEMP = 0,
+  // $XDG_RUNTIME_DIR, else a private flutter_alone-<uid> directory in the
+  // temp directory.
+  FLUTTER_ALONE_LOCK_DIRECTORY_RUNTIME = 1,
+} FlutterAloneLockDirectory;
+
+// Options for flutter_alone_check_and_run(). Zero-initialize before use so
+// fields added in later versions keep their defaults.
+typedef struct {
+  // Same value as LinuxConfig.lockFileName on the Dart side.
+  const gchar* lock_file_name;
+  // Message type: "en", "ko" or "custom". NULL means "en".
+  const gchar* type;
+  // Used when type is "custom". NULL means empty.
+  const gchar* custom_title;
+  const gchar* custom_message;
+  gboolean show_message_box;
+  // NULL-terminated arguments (without the program name) forwarded to the
+  // running instance, e.g. *arguments + 1 in local_command_line. NULL reads
+  // them from /proc/self/cmdline.
+  const gchar* const* arguments;
+  // NULL-terminated names of environment variables forwarded to the running
+  // instance. NULL forwards none.
+  const gchar* const* forwarded_environment;
+  // Deadline for the external activation helper, used only when no X
+  // connection (X11 or XWayland) is available. 0 means the default (2000).
+  gint activation_timeout_ms;
+  // Must match LinuxConfig.lockMode for checkAndRun to adopt the lock.
+  FlutterAloneLockMode lock_mode;
+  // Must match LinuxConfig.lockDirectory / lockDirectoryPath. A non-NULL
+  // absolute lock_directory_path overrides lock_directory.
+  FlutterAloneLockDirectory lock_directory;
+  const gchar* lock_directory_path;
+  // Must match LinuxConfig.maxInstances. 0 or 1 means a single instance.
+  gint max_instances;
+  // LinuxConfig.waitForLock: how long to wait for a held lock to be
+  // released (e.g. by a previous instance still exiting after an update)
+  // before treating the launch as a duplicate. 0 does not wait.
+  gint wait_for_lock_ms;
+  // LinuxConfig.forwardFiles / forwardStdin: pass the arguments that name
+  // regular files, and stdin when it is not a terminal, to the running
+  // instance as open files.
+  gboolean forward_files;
+  gboolean forward_stdin;
+} FlutterAloneCheckOptions;
+
+// Runs the duplicate-instance check natively, before the Flutter engine is
+// created. Intended to be called from the runner's local_command_line
+// handler before fl_dart_project_new(), so a rejected launch never boots the
+// engine.
+//
+// On FLUTTER_ALONE_CHECK_CAN_RUN the lock stays held and is adopted by the
+// plugin instance; a later checkAndRun call from Dart with the same
+// lockFileName returns true without re-acquiring it.
+FLUTTER_PLUGIN_EXPORT FlutterAloneCheckResult flutter_alone_check_and_run(
+    const FlutterAloneCheckOptions* options);
+
+// One running instance, as published in the shared instance registry.
+typedef struct {
+  gint pid;
+  // Start time in clock ticks since boot (field 22 of /proc/<pid>/stat);
+  // guards against PID reuse.
+  guint64 start_time;
+  // Top-level X11 window, or 0.
+  guint64 window_id;
+  // Holds the lock (or one of its slots).
+  gboolean primary;
+  // Serves the launch endpoint.
+  gboolean accepts_launches;
+  // Lock slot when max_instances > 1, or -1.
+  gint slot;
+} FlutterAloneInstanceInfo;
+
+// Reads the instance registry of lock_file_name without taking any lock,
+// e.g. for diagnostics tools. Copies up to capacity live entries into
+// instances and returns the number of live entries (which may exceed
+// capacity), or -1 if the registry cannot be opened.
+FLUTTER_PLUGIN_EXPORT gint flutter_alone_list_instances(
+    const gchar* lock_file_name, FlutterAloneInstanceInfo* instances, gint capacity);
+
 G_END_DECLS
 
 #endif  // FLUTTER_PLUGIN_FLUTTER_ALONE_PLUGIN_H_
@@ -0,0 +1,436 @@
+#include "instance_lock.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#include "ipc_utils.h"
+
+namespace flutter_alone {
+
+namespace {
+
+// Resolved like g_get_tmp_dir(), which earlier versions used, so they
+// agree on the default lock path: $TMPDIR, else P_tmpdir without its
+// trailing slash, read once per process.
+std::string get_tmp_dir() {
+  static const std::string tmp_dir = [] {
+    const char* tmp = getenv("TMPDIR");
+    if (tmp && tmp[0] != '\0') return std::string(tmp);
+#ifdef P_tmpdir
+    std::string dir = P_tmpdir;
+    if (dir.size() > 1 && dir.back() == '/') dir.pop_back();
+    return dir;
+#else
+    return std::string("/tmp");
+#endif
+  }();
+  return tmp_dir;
+}
+
+// mkdir -p; existing directories are fine.
+bool make_directories(const std::string& path, mode_t mode) {
+  for (size_t end = 1; end <= path.size(); end++) {
+    if (end != path.size() && path[end] != '/') continue;
+    std::string prefix = path.substr(0, end);
+    if (mkdir(prefix.c_str(), mode) != 0 && errno != EEXIST) return false;
+  }
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Reads the owner from the lock record of a held lock. A versioned record
+// left by an earlier boot or naming a reused PID is ignored; the owner may
+// be mid-acquire, and the registry lookup still applies.
+void read_lock_owner(int fd, LockAttempt* attempt) {
+  LockRecord record;
+  if (!read_lock_record(fd, &record)) return;
+  if (record.versioned) {
+    if (!record.boot_id.empty() && record.boot_id != get_boot_id()) return;
+    if (record.start_time != 0 && get_process_start_time(record.pid) != record.start_time) {
+      return;
+    }
+    // A window id only means something on the X display it came from.
+    const char* display = getenv("DISPLAY");
+    if (display && record.display == display) attempt->owner_window = record.window_id;
+    attempt->owner_start_time = record.start_time;
+  }
+  attempt->owner_pid = record.pid;
+}
+
+// Prepares the directory and opens the lock file. Returns -1 with
+// attempt->error_message set on failure.
+int open_lock_file(const LockTarget& target, LockAttempt* attempt) {
+  if (!prepare_lock_directory(target)) {
+    attempt->error_message = "Failed to prepare lock directory";
+    return -1;
+  }
+
+  // Open lock file with O_NOFOLLOW to prevent symlink attacks
+  int fd = open(target.path.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0644);
+  if (fd < 0) attempt->error_message = "Failed to open lock file";
+  return fd;
+}
+
+LockAttempt try_acquire_file_lock(const LockTarget& target, CheckDiagnostics* diagnostics) {
+  LockAttempt attempt;
+  bool prepared;
+  {
+    ScopedPhase phase(diagnostics, "prepareDirectory");
+    prepared = prepare_lock_directory(target);
+  }
+  if (!prepared) {
+    attempt.error_message = "Failed to prepare lock directory";
+    return attempt;
+  }
+
+  int held_fd = -1;
+  int fd;
+  {
+    ScopedPhase phase(diagnostics, "acquireLock");
+    fd = acquire_file_lock(target.path, &held_fd);
+  }
+  if (fd < 0) {
+    if (errno != EWOULDBLOCK) {
+      attempt.error_message = "Failed to open lock file";
+      return attempt;
+    }
+    // Read the record from the already-opened fd to avoid re-open TOCTOU
+    attempt.status = LockStatus::kHeldByOther;
+    if (held_fd >= 0) {
+      ScopedPhase phase(diagnostics, "readOwnerRecord");
+      read_lock_owner(held_fd, &attempt);
+      close(held_fd);
+    }
+    return attempt;
+  }
+
+  // We hold the lock. Publish our record. It only has to outlive us, not a
+  // reboot, so memory-backed file systems skip the sync.
+  ScopedPhase phase(diagnostics, "publishRecord");
+  bool memory_backed = false;
+  attempt.filesystem = get_filesystem_name(fd, &memory_backed);
+  attempt.synced = !memory_backed;
+  LockRecordPage* record = map_lock_record(fd);
+  if (!record) {
+    release_file_lock(target.path, fd);
+    attempt.error_message = "Failed to write PID to lock file";
+    return attempt;
+  }
+  publish_lock_record(record, make_lock_record(target.name), attempt.synced);
+
+  attempt.status = LockStatus::kAcquired;
+  attempt.fd = fd;
+  attempt.record = record;
+  return attempt;
+}
+
+// Among slot owners that are still running, returns the record of the one
+// activated least recently and stores its slot in *owner_slot; the pid is 0
+// and the slot -1 when there is none.
+LockSlotRecord pick_least_recently_active(int fd, int slot_count, int* owner_slot) {
+  LockSlotRecord owner;
+  int64_t owner_last_active = INT64_MAX;
+  *owner_slot = -1;
+  std::vector<LockSlotRecord> records = read_lock_slots(fd, slot_count);
+  for (int slot = 0; slot < slot_count; slot++) {
+    const LockSlotRecord& record = records[slot];
+    if (record.pid <= 0 || !is_process_running(record.pid)) continue;
+    if (record.last_active_ms < owner_last_active) {
+      owner = record;
+      owner_last_active = record.last_active_ms;
+      *owner_slot = slot;
+    }
+  }
+  return owner;
+}
+
+// maxInstances > 1: claims one of the byte-range slots of the lock file.
+LockAttempt try_acquire_slot_lock(const LockTarget& target, CheckDiagnostics* diagnostics) {
+  LockAttempt attempt;
+  int fd;
+  {
+    ScopedPhase phase(diagnostics, "prepareDirectory");
+    fd = open_lock_file(target, &attempt);
+  }
+  if (fd < 0) return attempt;
+
+  int slot;
+  {
+    ScopedPhase phase(diagnostics, "acquireLock");
+    slot = acquire_lock_slot(fd, target.max_instances);
+  }
+  if (slot < 0) {
+    if (errno == EAGAIN || errno == EACCES) {
+      ScopedPhase phase(diagnostics, "readOwnerRecord");
+      attempt.status = LockStatus::kHeldByOther;
+      int owner_slot;
+      LockSlotRecord owner = pick_least_recently_active(fd, target.max_instances, &owner_slot);
+      attempt.owner_pid = owner.pid > 0 ? owner.pid : -1;
+      attempt.owner_window = owner.window_id;
+      attempt.owner_slot = owner_slot;
+      // Mark the pick right away rather than when the owner handles the
+      // launch: it may only be activated through X11, and the next launch
+      // must go to another instance either way.
+      if (owner_slot >= 0) mark_lock_slot_active(fd, owner_slot);
+    } else {
+      attempt.error_message = "Failed to lock instance slot";
+    }
+    close(fd);
+    return attempt;
+  }
+
+  ScopedPhase phase(diagnostics, "publishRecord");
+  bool memory_backed = false;
+  attempt.filesystem = get_filesystem_name(fd, &memory_backed);
+  attempt.synced = !memory_backed;
+  LockSlotRecord record;
+  record.pid = getpid();
+  record.last_active_ms = current_time_ms();
+  if (!write_lock_slot(fd, slot, record, attempt.synced)) {
+    // Closing the description drops its slot lock.
+    close(fd);
+    attempt.error_message = "Failed to write PID to lock file";
+    return attempt;
+  }
+
+  attempt.status = LockStatus::kAcquired;
+  attempt.fd = fd;
+  attempt.slot = slot;
+  return attempt;
+}
+
+LockAttempt try_acquire_socket_lock(const char* lock_file_name, CheckDiagnostics* diagnostics) {
+  LockAttempt attempt;
+
+  int fd;
+  {
+    ScopedPhase phase(diagnostics, "acquireLock");
+    fd = create_lock_socket(lock_file_name);
+  }
+  if (fd >= 0) {
+    attempt.status = LockStatus::kAcquired;
+    attempt.fd = fd;
+    return attempt;
+  }
+  if (errno == EADDRINUSE) {
+    ScopedPhase phase(diagnostics, "readOwnerRecord");
+    attempt.status = LockStatus::kHeldByOther;
+    attempt.owner_pid = get_lock_socket_owner(lock_file_name);
+    return attempt;
+  }
+  attempt.error_message = "Failed to bind lock socket";
+  return attempt;
+}
+
+}  // namespace
+
+LockTarget get_lock_target(LockMode mode, LockDirectory directory, const char* directory_path,
+                           const char* lock_file_name, int max_instances) {
+  LockTarget target;
+  target.mode = mode;
+  target.name = lock_file_name;
+  if (max_instances > 1 && mode == LockMode::kFile) {
+    target.max_instances = max_instances < kMaxLockSlots ? max_instances : kMaxLockSlots;
+  }
+  if (mode == LockMode::kSocket) {
+    target.path = "@" + make_abstract_socket_name(lock_file_name, "lock");
+    return target;
+  }
+
+  const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+  if (directory_path && directory_path[0] == '/') {
+    target.directory = directory_path;
+    target.directory_setup = DirectorySetup::kCreate;
+  } else if (directory == LockDirectory::kRuntime && runtime_dir && runtime_dir[0] == '/') {
+    // Per-user tmpfs set up by the login manager.
+    target.directory = runtime_dir;
+  } else if (directory == LockDirectory::kRuntime) {
+    target.directory = get_tmp_dir() + "/flutter_alone-" + std::to_string(getuid());
+    target.directory_setup = DirectorySetup::kCreatePrivate;
+  } else {
+    target.directory = get_tmp_dir();
+  }
+  target.path = target.directory + "/" + lock_file_name;
+  return target;
+}
+
+bool prepare_lock_directory(const LockTarget& target) {
+  const char* dir = target.directory.c_str();
+  switch (target.directory_setup) {
+    case DirectorySetup::kNone:
+      return true;
+    case DirectorySetup::kCreate:
+      return make_directories(target.directory, 0700);
+    case DirectorySetup::kCreatePrivate: {
+      if (mkdir(dir, 0700) != 0 && errno != EEXIST) return false;
+      // lstat: refuse a symlink or a directory planted by another user.
+      struct stat st;
+      return lstat(dir, &st) == 0 && S_ISDIR(st.st_mode) &&
+             st.st_uid == getuid() && (st.st_mode & 077) == 0;
+    }
+  }
+  return false;
+}
+
+std::string get_filesystem_name(int fd, bool* memory_backed) {
+  *memory_backed = false;
+  struct statfs fs;
+  if (fstatfs(fd, &fs) != 0) return "unknown";
+
+  switch (static_cast<unsigned long>(fs.f_type)) {
+    case 0x01021994: *memory_backed = true; return "tmpfs";
+    case 0x858458f6: *memory_backed = true; return "ramfs";
+    case 0xEF53: return "ext4";
+    case 0x58465342: return "xfs";
+    case 0x9123683E: return "btrfs";
+    case 0x794c7630: return "overlayfs";
+    case 0x6969: return "nfs";
+    case 0x65735546: return "fuse";
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "0x%lx", static_cast<unsigned long>(fs.f_type));
+  return name;
+}
+
+bool is_process_running(pid_t pid) {
+  if (pid <= 0) return false;
+  if (kill(pid, 0) == 0) return true;
+  // errno == EPERM means the process exists but we lack permission (cross-user)
+  if (errno == EPERM) return true;
+  return false;
+}
+
+bool is_valid_lock_file_name(const char* lock_file_name) {
+  return lock_file_name != nullptr &&
+         strlen(lock_file_name) > 0 &&
+         strchr(lock_file_name, '/') == nullptr &&
+         strcmp(lock_file_name, ".") != 0 &&
+         strcmp(lock_file_name, "..") != 0;
+}
+
+LockRecord make_lock_record(const std::string& lock_file_name) {
+  LockRecord record;
+  record.pid = getpid();
+  record.start_time = get_process_start_time(record.pid);
+  record.boot_id = get_boot_id();
+  get_executable_id(record.pid, &record.exe_dev, &record.exe_ino);
+  const char* display = getenv("DISPLAY");
+  if (display) record.display = display;
+  record.ipc_address = make_launch_endpoint_name(lock_file_name, -1);
+  return record;
+}
+
+LockAttempt try_acquire_lock(const LockTarget& target, CheckDiagnostics* diagnostics) {
+  diagnostics->lock_mode = target.mode;
+  if (target.mode == LockMode::kSocket) {
+    return try_acquire_socket_lock(target.name.c_str(), diagnostics);
+  }
+  if (target.max_instances > 1) return try_acquire_slot_lock(target, diagnostics);
+  return try_acquire_file_lock(target, diagnostics);
+}
+
+LockAttempt wait_for_lock(const LockTarget& target, int timeout_ms, int cancel_fd,
+                          CheckDiagnostics* diagnostics) {
+  int64_t deadline = monotonic_time_us() + static_cast<int64_t>(timeout_ms) * 1000;
+  // A releasing owner unlinks its lock file, which reaches a watch on the
+  // old inode as IN_ATTRIB. Our own retries only open and close the file.
+  int inotify_fd = target.mode == LockMode::kFile ? inotify_init1(IN_NONBLOCK | IN_CLOEXEC) : -1;
+  LockAttempt attempt;
+  for (;;) {
+    // Watched before each retry, so a release right after it still wakes
+    // us, and re-added because a new owner may have created a new file.
+    bool watching = inotify_fd >= 0 &&
+                    inotify_add_watch(inotify_fd, target.path.c_str(),
+                                      IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF) >= 0;
+    attempt = try_acquire_lock(target, diagnostics);
+    int64_t remaining_ms = (deadline - monotonic_time_us() + 999) / 1000;
+    if (attempt.status != LockStatus::kHeldByOther || remaining_ms <= 0) break;
+
+    ScopedPhase phase(diagnostics, "waitForOwner");
+    ProcessHandle owner = ProcessHandle::Open(attempt.owner_pid, attempt.owner_start_time);
+    pollfd fds[3];
+    nfds_t count = 0;
+    if (cancel_fd >= 0) fds[count++] = {cancel_fd, POLLIN, 0};
+    if (owner.fd() >= 0) fds[count++] = {owner.fd(), POLLIN, 0};
+    if (watching) fds[count++] = {inotify_fd, POLLIN, 0};
+    // Without a pidfd (owner unknown: mid-acquire or its record not yet
+    // published; or no pidfd_open) nothing reports the owner dying, and
+    // with slots the owner is only the one a launch would be routed to:
+    // any other slot owner exiting frees a slot. Retry periodically then.
+    bool owner_wakes = owner.fd() >= 0 && target.max_instances <= 1;
+    int64_t wait_ms = owner_wakes ? remaining_ms
+                                  : std::min<int64_t>(remaining_ms, kWaitForLockRecheckMs);
+    if (poll(fds, count, static_cast<int>(wait_ms)) < 0 && errno != EINTR) break;
+    if (cancel_fd >= 0 && (fds[0].revents & POLLIN)) break;
+    if (watching) {
+      char events[4096];
+      while (read(inotify_fd, events, sizeof(events)) > 0) {}
+    }
+  }
+  if (inotify_fd >= 0) close(inotify_fd);
+  return attempt;
+}
+
+bool release_instance_lock(LockMode mode, const std::string& path, int fd, int slot,
+                           LockRecordPage* record) {
+  unmap_lock_record(record);
+  if (fd < 0) return true;
+  // Closing the socket releases its name and closing the description drops
+  // its slot lock; the whole-file lock also takes its file with it. Other
+  // instances may still hold slots in a shared slot file.
+  if (slot >= 0) {
+    write_lock_slot(fd, slot, LockSlotRecord(), false);
+    close(fd);
+    return true;
+  }
+  if (mode == LockMode::kFile) return release_file_lock(path, fd);
+  close(fd);
+  return true;
+}
+
+void find_lock_owner(InstanceRegistry* registry, const LockTarget& target, LockAttempt* attempt) {
+  InstanceInfo primary;
+  if (registry && target.max_instances <= 1 && registry->FindPrimary(&primary)) {
+    attempt->owner_pid = primary.pid;
+    attempt->owner_start_time = primary.start_time;
+    attempt->owner_window = primary.window_id;
+  }
+}
+
+int register_instance(InstanceRegistry* registry, const std::string& lock_file_name, int slot,
+                      bool accepts_launches) {
+  if (!registry) return -1;
+  InstanceInfo info;
+  info.pid = getpid();
+  info.start_time = get_process_start_time(info.pid);
+  info.flags = kInstanceFlagPrimary;
+  if (accepts_launches) {
+    info.flags |= kInstanceFlagAcceptsLaunches;
+    info.endpoint = make_launch_endpoint_name(lock_file_name, slot);
+  }
+  info.slot = slot;
+  return registry->Register(info);
+}
+
+ProcessHandle verify_lock_owner(const LockAttempt& attempt, CheckDiagnostics* diagnostics) {
+  ScopedPhase phase(diagnostics, "verifyOwner");
+  // Pinned before it is checked, so a PID reused mid-sequence is never
+  // activated.
+  ProcessHandle owner = ProcessHandle::Open(attempt.owner_pid, attempt.owner_start_time);
+  if (!owner.valid() || !is_same_program(owner.pid())) return ProcessHandle();
+  return owner;
+}
+
+}  // namespace flutter_alone
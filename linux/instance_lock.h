@@ -0,0 +1,192 @@
+#ifndef FLUTTER_PLUGIN_INSTANCE_LOCK_H_
+#define FLUTTER_PLUGIN_INSTANCE_LOCK_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lock_utils.h"
+#include "process_utils.h"
+#include "registry_utils.h"
+
+namespace flutter_alone {
+
+// One timed step of a check. start_us is relative to the start of the
+// check.
+struct CheckPhase {
+  const char* name;
+  int64_t start_us;
+  int64_t duration_us;
+};
+
+// How uniqueness is enforced (LinuxConfig.lockMode).
+enum class LockMode {
+  // flock() on a file in the temp directory, holding our PID.
+  kFile,
+  // An abstract-namespace socket bound to a per-user name; no filesystem I/O.
+  kSocket,
+};
+
+// Where the time of one checkAndRun (or pre-engine check) went, returned
+// by getLastCheckDiagnostics for startup telemetry.
+struct CheckDiagnostics {
+  int64_t started_us = monotonic_time_us();
+  int64_t total_us = 0;
+  bool pre_engine = false;
+  LockMode lock_mode = LockMode::kFile;
+  // "acquired", "alreadyRunning", "error", "cancelled", or "promoted" for
+  // a standby instance that took over the lock.
+  const char* outcome = nullptr;
+  std::vector<CheckPhase> phases;
+  // Whether the launch reached the running instance's endpoint.
+  bool forwarded = false;
+  // How the running instance was activated: "activationToken",
+  // "x11PublishedWindow", "x11Xres", "x11NetWmPid", "xdotool", or
+  // "coalesced" when another launch of the same burst activates it. Null
+  // when activation was not attempted.
+  const char* activation_backend = nullptr;
+  bool activation_succeeded = false;
+};
+
+// Records the lifetime of the scope as a phase of diagnostics.
+struct ScopedPhase {
+  ScopedPhase(CheckDiagnostics* diagnostics, const char* name)
+      : diagnostics(diagnostics), name(name), start_us(monotonic_time_us()) {}
+  ~ScopedPhase() {
+    diagnostics->phases.push_back({name, start_us - diagnostics->started_us,
+                                   monotonic_time_us() - start_us});
+  }
+  ScopedPhase(const ScopedPhase&) = delete;
+  ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+  CheckDiagnostics* diagnostics;
+  const char* name;
+  int64_t start_us;
+};
+
+// Where the lock file goes (LinuxConfig.lockDirectory).
+enum class LockDirectory { kSystemTemp, kRuntime };
+
+// What must happen to the lock directory before the lock file is opened.
+enum class DirectorySetup {
+  kNone,
+  // Create it (and its parents) if missing.
+  kCreate,
+  // Create it if missing, then insist it is a real directory owned by us
+  // and closed to others: it lives in world-writable /tmp.
+  kCreatePrivate,
+};
+
+// Everything needed to acquire one lock, resolved on the calling thread
+// without touching the filesystem.
+struct LockTarget {
+  LockMode mode = LockMode::kFile;
+  std::string name;
+  // Lock file directory (file mode only).
+  std::string directory;
+  DirectorySetup directory_setup = DirectorySetup::kNone;
+  // Lock file path, or "@<abstract name>" for the socket mode. Identifies
+  // the lock for comparisons and logging.
+  std::string path;
+  // Number of instance slots (file mode only); 1 keeps the whole-file flock.
+  int max_instances = 1;
+};
+
+// directory_path, when absolute, overrides directory. The system temp
+// directory is $TMPDIR, else /tmp.
+LockTarget get_lock_target(LockMode mode, LockDirectory directory, const char* directory_path,
+                           const char* lock_file_name, int max_instances);
+
+bool prepare_lock_directory(const LockTarget& target);
+
+// Names the file system fd lives on. memory_backed is set for tmpfs and
+// ramfs, where a sync has no disk to reach.
+std::string get_filesystem_name(int fd, bool* memory_backed);
+
+// kill(pid, 0), counting EPERM (another user's process) as running.
+bool is_process_running(pid_t pid);
+
+// Not empty, no path separators, not "." or "..".
+bool is_valid_lock_file_name(const char* lock_file_name);
+
+enum class LockStatus { kAcquired, kHeldByOther, kError };
+
+// Result of try_acquire_lock(), shared by checkAndRun and the pre-engine check.
+struct LockAttempt {
+  LockStatus status = LockStatus::kError;
+  // Locked fd with our PID written, owned by the caller (kAcquired only).
+  int fd = -1;
+  // PID recorded by the current owner, or -1 (kHeldByOther only).
+  pid_t owner_pid = -1;
+  // Start time the owner recorded for itself, or 0 when unknown (legacy
+  // records, socket mode) (kHeldByOther only).
+  uint64_t owner_start_time = 0;
+  // X11 window published by the current owner, or 0 (kHeldByOther only).
+  uint64_t owner_window = 0;
+  // Instance slot of the chosen owner, whose launch endpoint receives the
+  // launch, or -1 (kHeldByOther with maxInstances > 1 only).
+  int owner_slot = -1;
+  // Static description of the failure (kError only).
+  const char* error_message = nullptr;
+  // File system of the lock file and whether our PID was synced to it
+  // (kAcquired in file mode only).
+  std::string filesystem;
+  bool synced = false;
+  // Acquired instance slot, or -1 (kAcquired with maxInstances > 1 only).
+  int slot = -1;
+  // Our mapped lock record (kAcquired in single-instance file mode only).
+  LockRecordPage* record = nullptr;
+};
+
+// Our lock record: who we are, and where rejected launches can reach us.
+LockRecord make_lock_record(const std::string& lock_file_name);
+
+// Takes the lock described by target without blocking. On kHeldByOther the
+// owner is read from the lock itself (record, slot file or SO_PEERCRED).
+LockAttempt try_acquire_lock(const LockTarget& target, CheckDiagnostics* diagnostics);
+
+// How often wait_for_lock() retries while it has no pidfd for the owner,
+// e.g. while the owner has not published its record yet, and with slots.
+constexpr int kWaitForLockRecheckMs = 100;
+
+// Like try_acquire_lock(), but while the lock is held waits up to
+// timeout_ms for it to become free, e.g. for an old instance that is still
+// shutting down when an updater relaunches the app. For a single-instance
+// lock, each wait blocks on the owner's pidfd for the rest of the timeout
+// and, for a lock file, on the file being unlinked by an owner that
+// releases without exiting; a socket released that way is retried at the
+// deadline. Slot locks are retried every kWaitForLockRecheckMs.
+// Returns early, with kHeldByOther, once cancel_fd (-1 for none) becomes
+// readable, and once the deadline passes.
+LockAttempt wait_for_lock(const LockTarget& target, int timeout_ms, int cancel_fd,
+                          CheckDiagnostics* diagnostics);
+
+// Drops a lock acquired by try_acquire_lock() at path (LockTarget.path).
+// slot and record are those of the attempt. Returns false with errno set
+// when the lock file could not be unlinked; the lock is released
+// regardless.
+bool release_instance_lock(LockMode mode, const std::string& path, int fd, int slot,
+                           LockRecordPage* record);
+
+// The registry names the primary and its window directly, already checked
+// against PID reuse. Slot mode keeps the least recently active slot owner
+// picked from the lock file, which is also the fallback when the registry
+// has no entry.
+void find_lock_owner(InstanceRegistry* registry, const LockTarget& target, LockAttempt* attempt);
+
+// Publishes this process as a lock holder. Returns the entry index, or -1
+// when registry is null or full; the registry only speeds up lookups, so
+// failure is not an error.
+int register_instance(InstanceRegistry* registry, const std::string& lock_file_name, int slot,
+                      bool accepts_launches);
+
+// Pins the owner named by attempt and checks that it runs the same program
+// as we do. Returns an invalid handle otherwise; a PID reused mid-sequence
+// is never returned.
+ProcessHandle verify_lock_owner(const LockAttempt& attempt, CheckDiagnostics* diagnostics);
+
+}  // namespace flutter_alone
+
+#endif  // FLUTTER_PLUGIN_INSTANCE_LOCK_H_
@@ -0,0 +1,601 @@
+#include "ipc_utils.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace flutter_alone {
+
+namespace {
+
+constexpr uint32_t kLaunchFrameMagic = 0x464C414E;  // "FLAN"
+// Payload in a memfd, passed as the first fd after the header.
+constexpr uint32_t kLaunchFrameMemfdMagic = 0x464C414D;  // "FLAM"
+// Version 2 appends the activation token, version 3 the files passed
+// with the frame. Version 3 is only sent when there are files, so older
+// primaries still take every other launch; older payloads are still
+// accepted from older secondaries.
+constexpr uint32_t kLaunchPayloadVersion = 3;
+
+// Longest name that fits sun_path after the leading NUL byte.
+constexpr size_t kMaxAbstractNameLength = sizeof(sockaddr_un::sun_path) - 1;
+
+void append_u32(std::string* out, uint32_t value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void append_string(std::string* out, const std::string& value) {
+  append_u32(out, static_cast<uint32_t>(value.size()));
+  out->append(value);
+}
+
+void append_strings(std::string* out, const std::vector<std::string>& values) {
+  append_u32(out, static_cast<uint32_t>(values.size()));
+  for (const std::string& value : values) append_string(out, value);
+}
+
+// Bounds-checked reader over a decoded payload.
+class PayloadReader {
+ public:
+  PayloadReader(const char* data, size_t length) : data_(data), remaining_(length) {}
+
+  bool read_u32(uint32_t* value) {
+    if (remaining_ < sizeof(*value)) return false;
+    memcpy(value, data_, sizeof(*value));
+    advance(sizeof(*value));
+    return true;
+  }
+
+  bool read_string(std::string* value) {
+    uint32_t length = 0;
+    if (!read_u32(&length) || remaining_ < length) return false;
+    value->assign(data_, length);
+    advance(length);
+    return true;
+  }
+
+  bool read_strings(std::vector<std::string>* values) {
+    uint32_t count = 0;
+    if (!read_u32(&count)) return false;
+    // Every entry needs at least its length prefix.
+    if (count > remaining_ / sizeof(uint32_t)) return false;
+    values->resize(count);
+    for (std::string& value : *values) {
+      if (!read_string(&value)) return false;
+    }
+    return true;
+  }
+
+ private:
+  void advance(size_t n) {
+    data_ += n;
+    remaining_ -= n;
+  }
+
+  const char* data_;
+  size_t remaining_;
+};
+
+socklen_t make_abstract_address(const std::string& name, sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  // sun_path[0] stays NUL: abstract namespace, no filesystem entry.
+  memcpy(addr->sun_path + 1, name.data(), name.size());
+  return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + name.size());
+}
+
+int64_t monotonic_ms() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Waits for events on fd until deadline_ms (CLOCK_MONOTONIC).
+bool poll_until(int fd, short events, int64_t deadline_ms) {
+  for (;;) {
+    int64_t remaining = deadline_ms - monotonic_ms();
+    if (remaining <= 0) return false;
+    pollfd pfd = {fd, events, 0};
+    int ret = poll(&pfd, 1, static_cast<int>(remaining));
+    if (ret > 0) return true;
+    if (ret == 0) return false;
+    if (errno != EINTR) return false;
+  }
+}
+
+int create_abstract_listener(const std::string& name, int flags) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | flags, 0);
+  if (fd < 0) return -1;
+
+  sockaddr_un addr;
+  socklen_t addr_len = make_abstract_address(name, &addr);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return -1;
+  }
+  return fd;
+}
+
+bool send_all(int fd, const char* data, size_t length, int64_t deadline_ms) {
+  while (length > 0) {
+    ssize_t n = send(fd, data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0) {
+      data += n;
+      length -= static_cast<size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!poll_until(fd, POLLOUT, deadline_ms)) return false;
+      continue;
+    }
+    return false;
+  }
+  return true;
+}
+
+std::string encode_launch_payload(const LaunchRequest& request) {
+  std::string payload;
+  append_u32(&payload, request.files.empty() ? 2 : kLaunchPayloadVersion);
+  append_string(&payload, request.working_directory);
+  append_strings(&payload, request.arguments);
+  append_strings(&payload, request.environment);
+  append_string(&payload, request.activation_token);
+  if (!request.files.empty()) {
+    append_u32(&payload, static_cast<uint32_t>(request.files.size()));
+    for (const LaunchFile& file : request.files) {
+      append_u32(&payload, static_cast<uint32_t>(file.argument_index));
+    }
+  }
+  return payload;
+}
+
+// Sealed against every change, so the primary can map it without copying
+// and without racing us.
+int create_payload_memfd(const std::string& payload) {
+  int fd = memfd_create("flutter_alone-launch", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) return -1;
+  size_t written = 0;
+  while (written < payload.size()) {
+    ssize_t n = write(fd, payload.data() + written, payload.size() - written);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      close(fd);
+      return -1;
+    }
+    written += static_cast<size_t>(n);
+  }
+  if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Only memfds sealed against writes and shrinking are mapped: otherwise the
+// sender could change the payload while it is decoded, or truncate it and
+// fault the mapping with SIGBUS.
+bool decode_memfd_payload(int memfd, size_t length, LaunchRequest* request) {
+  constexpr int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_WRITE;
+  int seals = fcntl(memfd, F_GET_SEALS);
+  if (seals < 0 || (seals & kRequiredSeals) != kRequiredSeals) return false;
+  struct stat st;
+  if (length == 0 || fstat(memfd, &st) != 0 || static_cast<uint64_t>(st.st_size) < length) {
+    return false;
+  }
+  void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, memfd, 0);
+  if (data == MAP_FAILED) return false;
+  bool decoded = decode_launch_request(static_cast<const char*>(data), length, request);
+  munmap(data, length);
+  return decoded;
+}
+
+// Sends one byte carrying fds as SCM_RIGHTS.
+bool send_fds(int fd, const std::vector<int>& fds, int64_t deadline_ms) {
+  if (fds.size() > kMaxLaunchFds) return false;
+  char byte = 0;
+  iovec iov = {&byte, sizeof(byte)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxLaunchFds)];
+  size_t fds_size = sizeof(int) * fds.size();
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(fds_size);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(fds_size);
+  memcpy(CMSG_DATA(cmsg), fds.data(), fds_size);
+
+  for (;;) {
+    ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n == 1) return true;
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!poll_until(fd, POLLOUT, deadline_ms)) return false;
+      continue;
+    }
+    return false;
+  }
+}
+
+void close_fds(std::vector<int>* fds) {
+  for (int fd : *fds) close(fd);
+  fds->clear();
+}
+
+// Looks up name in our initial environment. GTK unsets the startup
+// variables while initializing, so /proc/self/environ (the environment at
+// exec time) is consulted when getenv() no longer has them.
+std::string get_initial_env(const char* name) {
+  const char* value = getenv(name);
+  if (value) return value;
+
+  std::ifstream environ_file("/proc/self/environ", std::ios::binary);
+  std::string prefix = std::string(name) + "=";
+  std::string entry;
+  while (std::getline(environ_file, entry, '\0')) {
+    if (entry.compare(0, prefix.size(), prefix) == 0) return entry.substr(prefix.size());
+  }
+  return std::string();
+}
+
+}  // namespace
+
+uint64_t fnv1a_64(const std::string& value) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : value) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string make_abstract_socket_name(const std::string& lock_file_name,
+                                      const char* suffix) {
+  std::string prefix = "flutter_alone/" + std::to_string(getuid()) + "/";
+  std::string tail = std::string("/") + suffix;
+  std::string name = prefix + lock_file_name + tail;
+  if (name.size() <= kMaxAbstractNameLength) return name;
+
+  // Long lock names are replaced by a stable hash so the name still fits.
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx",
+           static_cast<unsigned long long>(fnv1a_64(lock_file_name)));
+  return prefix + hash + tail;
+}
+
+LaunchRequest make_current_launch_request(
+    const char* const* arguments,
+    const std::vector<std::string>& environment_names) {
+  LaunchRequest request;
+
+  if (arguments) {
+    for (const char* const* arg = arguments; *arg; ++arg) {
+      request.arguments.emplace_back(*arg);
+    }
+  } else {
+    // NUL-separated argv; the first entry is the program name.
+    std::ifstream cmdline("/proc/self/cmdline", std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(cmdline)),
+                     std::istreambuf_iterator<char>());
+    size_t start = data.find('\0');
+    while (start != std::string::npos && start + 1 < data.size()) {
+      size_t end = data.find('\0', start + 1);
+      if (end == std::string::npos) end = data.size();
+      request.arguments.emplace_back(data, start + 1, end - start - 1);
+      start = end;
+    }
+  }
+
+  char cwd[PATH_MAX];
+  if (getcwd(cwd, sizeof(cwd))) request.working_directory = cwd;
+
+  for (const std::string& name : environment_names) {
+    const char* value = getenv(name.c_str());
+    if (value) request.environment.push_back(name + "=" + value);
+  }
+
+  request.activation_token = get_initial_env("XDG_ACTIVATION_TOKEN");
+  if (request.activation_token.empty()) {
+    request.activation_token = get_initial_env("DESKTOP_STARTUP_ID");
+  }
+
+  return request;
+}
+
+void open_launch_files(LaunchRequest* request, bool arguments, bool with_stdin) {
+  if (with_stdin && !isatty(STDIN_FILENO)) {
+    struct stat st;
+    if (fstat(STDIN_FILENO, &st) == 0 &&
+        (S_ISREG(st.st_mode) || S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode))) {
+      int fd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0);
+      if (fd >= 0) request->files.push_back({kLaunchFileStdin, fd});
+    }
+  }
+  if (!arguments) return;
+
+  size_t opened = 0;
+  for (size_t i = 0; i < request->arguments.size() && opened < kMaxLaunchFiles; i++) {
+    const std::string& argument = request->arguments[i];
+    // Options, not paths.
+    if (argument.empty() || argument[0] == '-') continue;
+    // O_NONBLOCK so a FIFO argument cannot stall the launch.
+    int fd = open(argument.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) continue;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      close(fd);
+      continue;
+    }
+    request->files.push_back({static_cast<int32_t>(i), fd});
+    opened++;
+  }
+}
+
+void close_launch_files(LaunchRequest* request) {
+  for (const LaunchFile& file : request->files) {
+    if (file.fd >= 0) close(file.fd);
+  }
+  request->files.clear();
+}
+
+std::string encode_launch_request(const LaunchRequest& request) {
+  std::string payload = encode_launch_payload(request);
+  std::string frame;
+  frame.reserve(kLaunchFrameHeaderSize + payload.size());
+  append_u32(&frame, kLaunchFrameMagic);
+  append_u32(&frame, static_cast<uint32_t>(payload.size()));
+  frame.append(payload);
+  return frame;
+}
+
+int64_t parse_launch_frame_header(const char* header, bool* payload_in_memfd) {
+  uint32_t magic = 0;
+  uint32_t length = 0;
+  memcpy(&magic, header, sizeof(magic));
+  memcpy(&length, header + sizeof(magic), sizeof(length));
+  if (magic == kLaunchFrameMagic && length <= kMaxLaunchPayloadSize) {
+    *payload_in_memfd = false;
+    return length;
+  }
+  if (magic == kLaunchFrameMemfdMagic && length > 0 && length <= kMaxLaunchMemfdPayloadSize) {
+    *payload_in_memfd = true;
+    return length;
+  }
+  return -1;
+}
+
+bool decode_launch_request(const char* payload, size_t length,
+                           LaunchRequest* request) {
+  PayloadReader reader(payload, length);
+  uint32_t version = 0;
+  if (!reader.read_u32(&version) || version < 1 || version > kLaunchPayloadVersion) {
+    return false;
+  }
+  if (!reader.read_string(&request->working_directory) ||
+      !reader.read_strings(&request->arguments) ||
+      !reader.read_strings(&request->environment)) {
+    return false;
+  }
+  if (version < 2) return true;
+  if (!reader.read_string(&request->activation_token)) return false;
+  if (version < 3) return true;
+
+  uint32_t count = 0;
+  if (!reader.read_u32(&count) || count > kMaxLaunchFiles + 1) return false;
+  request->files.resize(count);
+  for (LaunchFile& file : request->files) {
+    uint32_t index = 0;
+    if (!reader.read_u32(&index)) return false;
+    file.argument_index = static_cast<int32_t>(index);
+    if (file.argument_index != kLaunchFileStdin &&
+        (file.argument_index < 0 ||
+         static_cast<size_t>(file.argument_index) >= request->arguments.size())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int receive_launch_fds(int socket_fd, std::vector<int>* fds) {
+  char byte = 0;
+  iovec iov = {&byte, sizeof(byte)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxLaunchFds)];
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t n;
+  do {
+    n = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+  if (n != 1) return -1;
+
+  fds->clear();
+  for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+    size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    for (size_t i = 0; i < count; i++) {
+      int fd;
+      memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(fd));
+      fds->push_back(fd);
+    }
+  }
+  // More fds than we accept: the kernel dropped the rest.
+  if (msg.msg_flags & MSG_CTRUNC) {
+    close_fds(fds);
+    return -1;
+  }
+  return fds->empty() ? -1 : 1;
+}
+
+bool attach_launch_fds(std::vector<int>* fds, bool payload_in_memfd, size_t length,
+                       LaunchRequest* request) {
+  if (payload_in_memfd) {
+    if (fds->empty()) return false;
+    int memfd = fds->front();
+    fds->erase(fds->begin());
+    bool decoded = decode_memfd_payload(memfd, length, request);
+    close(memfd);
+    if (!decoded) {
+      close_fds(fds);
+      return false;
+    }
+  }
+  if (fds->size() != request->files.size()) {
+    close_fds(fds);
+    request->files.clear();
+    return false;
+  }
+  for (size_t i = 0; i < fds->size(); i++) request->files[i].fd = (*fds)[i];
+  fds->clear();
+  return true;
+}
+
+int create_lock_socket(const std::string& lock_file_name) {
+  return create_abstract_listener(make_abstract_socket_name(lock_file_name, "lock"),
+                                  SOCK_NONBLOCK);
+}
+
+pid_t get_lock_socket_owner(const std::string& lock_file_name) {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) return -1;
+
+  sockaddr_un addr;
+  socklen_t addr_len = make_abstract_address(
+      make_abstract_socket_name(lock_file_name, "lock"), &addr);
+
+  // The listener's credentials are recorded at listen() time, so they are
+  // available as soon as connect() succeeds, before any accept().
+  pid_t owner = -1;
+  ucred peer;
+  socklen_t peer_len = sizeof(peer);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), addr_len) == 0 &&
+      getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) == 0 &&
+      peer.uid == getuid()) {
+    owner = peer.pid;
+  }
+  close(fd);
+  return owner;
+}
+
+std::string make_launch_endpoint_name(const std::string& lock_file_name, int slot) {
+  if (slot < 0) return make_abstract_socket_name(lock_file_name, "launch");
+  return make_abstract_socket_name(lock_file_name, ("launch." + std::to_string(slot)).c_str());
+}
+
+int create_launch_listener(const std::string& lock_file_name, int slot) {
+  return create_abstract_listener(make_launch_endpoint_name(lock_file_name, slot), 0);
+}
+
+namespace {
+
+// Sends request over a new connection and waits for the ack. rejected is
+// set when the primary closed the connection without one, e.g. because it
+// cannot decode the payload.
+uint8_t exchange_launch_request(const sockaddr_un& addr, socklen_t addr_len,
+                                const LaunchRequest& request, pid_t expected_pid,
+                                int64_t deadline, bool* rejected) {
+  *rejected = false;
+  std::string payload = encode_launch_payload(request);
+  bool in_memfd = payload.size() > kMaxLaunchPayloadSize;
+  if (payload.size() > kMaxLaunchMemfdPayloadSize) return kLaunchAckNone;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) return kLaunchAckNone;
+
+  int memfd = -1;
+  uint8_t ack = kLaunchAckNone;
+  do {
+    // AF_UNIX connect completes or fails immediately; EAGAIN means the
+    // listener's backlog is full.
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), addr_len) != 0) break;
+
+    // Abstract names can be bound by anyone: check who is listening.
+    ucred peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_len) != 0) break;
+    if (peer.uid != getuid()) break;
+    if (expected_pid > 0 && peer.pid != expected_pid) break;
+
+    std::string frame;
+    std::vector<int> fds;
+    append_u32(&frame, in_memfd ? kLaunchFrameMemfdMagic : kLaunchFrameMagic);
+    append_u32(&frame, static_cast<uint32_t>(payload.size()));
+    if (in_memfd) {
+      memfd = create_payload_memfd(payload);
+      if (memfd < 0) break;
+      fds.push_back(memfd);
+    } else {
+      frame.append(payload);
+    }
+    for (const LaunchFile& file : request.files) fds.push_back(file.fd);
+
+    if (!send_all(fd, frame.data(), frame.size(), deadline)) break;
+    if (!fds.empty() && !send_fds(fd, fds, deadline)) {
+      *rejected = errno == EPIPE || errno == ECONNRESET;
+      break;
+    }
+
+    if (!poll_until(fd, POLLIN, deadline)) break;
+    uint8_t reply = kLaunchAckNone;
+    ssize_t n = recv(fd, &reply, sizeof(reply), 0);
+    // A primary closing with our fd byte unread resets the connection.
+    if (n == 0 || (n < 0 && errno == ECONNRESET)) *rejected = true;
+    if (n != 1) break;
+    ack = reply;
+  } while (false);
+
+  if (memfd >= 0) close(memfd);
+  close(fd);
+  return ack;
+}
+
+}  // namespace
+
+uint8_t send_launch_request(const std::string& lock_file_name, int slot,
+                            const LaunchRequest& request, pid_t expected_pid) {
+  int64_t deadline = monotonic_ms() + kLaunchForwardTimeoutMs;
+
+  sockaddr_un addr;
+  socklen_t addr_len = make_abstract_address(make_launch_endpoint_name(lock_file_name, slot),
+                                             &addr);
+
+  bool rejected = false;
+  uint8_t ack = exchange_launch_request(addr, addr_len, request, expected_pid, deadline,
+                                        &rejected);
+  if (ack == kLaunchAckNone && rejected && !request.files.empty()) {
+    LaunchRequest without_files = request;
+    without_files.files.clear();
+    ack = exchange_launch_request(addr, addr_len, without_files, expected_pid, deadline,
+                                  &rejected);
+  }
+  return ack;
+}
+
+}  // namespace flutter_alone
@@ -0,0 +1,151 @@
+#ifndef FLUTTER_PLUGIN_IPC_UTILS_H_
+#define FLUTTER_PLUGIN_IPC_UTILS_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace flutter_alone {
+
+// LaunchFile::argument_index of our standard input.
+constexpr int32_t kLaunchFileStdin = -1;
+
+// An open file handed to the primary with SCM_RIGHTS along with a launch.
+struct LaunchFile {
+  // Index into LaunchRequest::arguments of the path the file was opened
+  // from, or kLaunchFileStdin.
+  int32_t argument_index = kLaunchFileStdin;
+  int fd = -1;
+};
+
+// Launch details a rejected instance forwards to the running primary.
+struct LaunchRequest {
+  // Command-line arguments without the program name.
+  std::vector<std::string> arguments;
+  std::string working_directory;
+  // Selected environment entries, each formatted as "NAME=value".
+  std::vector<std::string> environment;
+  // Activation token handed to us by the launcher (xdg-activation on
+  // Wayland, startup notification ID on X11); empty when there is none.
+  std::string activation_token;
+  // Files passed along with the request. The fds belong to whoever holds
+  // the request; see close_launch_files().
+  std::vector<LaunchFile> files;
+};
+
+// Frame layout: magic (u32), payload length (u32), payload. A request with
+// files is followed by one byte carrying their fds (SCM_RIGHTS). A payload
+// larger than kMaxLaunchPayloadSize, e.g. a multi-megabyte file list, is
+// not sent inline: it goes in a sealed memfd, passed as the first of those
+// fds. The primary replies with a single kLaunchAck* byte.
+constexpr size_t kLaunchFrameHeaderSize = 8;
+constexpr uint32_t kMaxLaunchPayloadSize = 1024 * 1024;
+constexpr uint32_t kMaxLaunchMemfdPayloadSize = 64 * 1024 * 1024;
+// Most argument files passed with one launch.
+constexpr size_t kMaxLaunchFiles = 64;
+// Most fds following a frame: the memfd, stdin and the argument files
+// (SCM_RIGHTS allows 253 per message).
+constexpr size_t kMaxLaunchFds = kMaxLaunchFiles + 2;
+// Nothing was delivered (no reply, or no primary listening).
+constexpr uint8_t kLaunchAckNone = 0;
+constexpr uint8_t kLaunchAckDelivered = 1;
+// Delivered, and the primary presented its window with our activation token.
+constexpr uint8_t kLaunchAckActivated = 2;
+// Delivered as part of a burst of launches; another launch of the burst
+// activates the window, so we must not.
+constexpr uint8_t kLaunchAckCoalesced = 3;
+
+// Timeout for the whole send/ack exchange on the secondary side.
+constexpr int kLaunchForwardTimeoutMs = 1000;
+
+// Stable 64-bit FNV-1a hash, used to shorten names derived from long lock
+// file names.
+uint64_t fnv1a_64(const std::string& value);
+
+// Builds an abstract-namespace socket name scoped to the current user and
+// lock file, e.g. "flutter_alone/1000/my_app.lock/launch". The returned
+// string does not include the leading NUL byte.
+std::string make_abstract_socket_name(const std::string& lock_file_name,
+                                      const char* suffix);
+
+// Collects our own cwd, the requested environment variables and the
+// launcher's activation token. When arguments is null, argv is read from
+// /proc/self/cmdline.
+LaunchRequest make_current_launch_request(
+    const char* const* arguments,
+    const std::vector<std::string>& environment_names);
+
+// Opens the arguments of request that name regular files and, when
+// with_stdin is set and stdin is not a terminal, duplicates stdin, so the
+// primary reads them through our handles. Paths it could not resolve
+// (another mount namespace, a portal path, a deleted temp file) still
+// work, and nothing can replace a file between our check and its read.
+void open_launch_files(LaunchRequest* request, bool arguments, bool with_stdin);
+
+// Closes the fds of request->files and clears it.
+void close_launch_files(LaunchRequest* request);
+
+// Encodes request as an inline frame. Its files are described but their
+// fds are not part of the frame.
+std::string encode_launch_request(const LaunchRequest& request);
+
+// Returns the payload length announced by a frame header, or -1 when the
+// header is malformed or the length is over the limit for its kind.
+// payload_in_memfd is set when the payload comes in a memfd instead of
+// inline.
+int64_t parse_launch_frame_header(const char* header, bool* payload_in_memfd);
+
+// Decodes an inline payload. Files are listed with fd -1 until
+// attach_launch_fds() fills them in.
+bool decode_launch_request(const char* payload, size_t length,
+                           LaunchRequest* request);
+
+// Receives the fds that follow a frame, close-on-exec. Returns 1 on
+// success, 0 when nothing has arrived yet on a non-blocking socket, and -1
+// on errors or a message without fds.
+int receive_launch_fds(int socket_fd, std::vector<int>* fds);
+
+// Completes a request with the fds received after its frame: decodes the
+// memfd payload first when payload_in_memfd (length is the frame's), then
+// hands the remaining fds to request->files in order. Takes ownership of
+// fds; on failure, everything is closed and false returned.
+bool attach_launch_fds(std::vector<int>* fds, bool payload_in_memfd, size_t length,
+                       LaunchRequest* request);
+
+// Binds the abstract lock name for lock_file_name and listens on it, so the
+// name itself is the lock: the kernel frees it when the last fd closes,
+// including on crash, and nothing touches the filesystem. The fd is
+// non-blocking. Returns -1 with errno set (EADDRINUSE when another process
+// holds the lock).
+int create_lock_socket(const std::string& lock_file_name);
+
+// Returns the PID of the process holding the lock socket, read with
+// SO_PEERCRED on connect, or -1 when it is unreachable or belongs to
+// another user.
+pid_t get_lock_socket_owner(const std::string& lock_file_name);
+
+// Abstract name of the launch endpoint of the instance holding slot of
+// lock_file_name, or of the single instance when slot is -1. Each slot has
+// its own endpoint, so a launch reaches the owner it was routed to.
+std::string make_launch_endpoint_name(const std::string& lock_file_name, int slot);
+
+// Binds and listens on the launch endpoint for lock_file_name and slot.
+// Returns the listening fd, or -1 with errno set (EADDRINUSE when another
+// process already serves the endpoint).
+int create_launch_listener(const std::string& lock_file_name, int slot);
+
+// Sends request to the primary serving slot of lock_file_name and returns
+// its kLaunchAck* reply (kLaunchAckNone on failure). Only delivers to a
+// listener owned by our own user, and to expected_pid when it is positive.
+// Primaries
+// that predate file passing reject a request with files; it is then sent
+// again without them. The caller keeps ownership of request's fds.
+uint8_t send_launch_request(const std::string& lock_file_name, int slot,
+                            const LaunchRequest& request, pid_t expected_pid);
+
+}  // namespace flutter_alone
+
+#endif  // FLUTTER_PLUGIN_IPC_UTILS_H_
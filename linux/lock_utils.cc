@@ -0,0 +1,307 @@
+#include "lock_utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace flutter_alone {
+
+namespace {
+
+constexpr uint32_t kLockSlotMagic = 0x4C534C46;  // "FLSL"
+
+// On-disk slot layout: magic (u32), pid (i32), last_active_ms (i64),
+// window_id (u64); the rest of the slot is reserved and zero.
+constexpr size_t kSlotMagicOffset = 0;
+constexpr size_t kSlotPidOffset = 4;
+constexpr size_t kSlotLastActiveOffset = 8;
+constexpr size_t kSlotWindowOffset = 16;
+
+constexpr uint32_t kLockRecordMagic = 0x524C4C46;  // "FLLR"
+constexpr uint32_t kLockRecordVersion = 1;
+
+// pread attempts before a record that keeps changing is given up on.
+constexpr int kLockRecordReadAttempts = 4;
+
+// Opens before a lock file that keeps being replaced is reported as held.
+constexpr int kFileLockAttempts = 16;
+
+}  // namespace
+
+// On-disk layout of the record. Field order and sizes are part of the
+// format; new fields go into reserved and bump the version.
+struct LockRecordPage {
+  // Decimal PID and newline, NUL-padded, for readers that predate the
+  // binary record.
+  char text_pid[16];
+  uint32_t magic;
+  uint32_t version;
+  // Odd while the owner is rewriting the fields below.
+  uint32_t seq;
+  int32_t pid;
+  uint64_t start_time;
+  char boot_id[40];
+  uint64_t exe_dev;
+  uint64_t exe_ino;
+  uint64_t window_id;
+  char display[64];
+  char ipc_address[108];
+  // FNV-1a over version through ipc_address, excluding seq.
+  uint32_t checksum;
+  char reserved[232];
+};
+
+static_assert(sizeof(LockRecordPage) == kLockRecordSize, "lock record layout changed");
+
+namespace {
+
+uint32_t record_checksum(const LockRecordPage& page) {
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 16777619u;
+    }
+  };
+  mix(&page.version, sizeof(page.version));
+  const char* begin = reinterpret_cast<const char*>(&page.pid);
+  const char* end = reinterpret_cast<const char*>(&page.checksum);
+  mix(begin, static_cast<size_t>(end - begin));
+  return hash;
+}
+
+void copy_field(char* dest, size_t size, const std::string& value) {
+  memset(dest, 0, size);
+  memcpy(dest, value.data(), std::min(value.size(), size - 1));
+}
+
+std::string read_field(const char* src, size_t size) {
+  return std::string(src, strnlen(src, size));
+}
+
+// Rewrites every field after seq; the caller is the only writer.
+void write_record_fields(LockRecordPage* page, const LockRecord& record) {
+  uint32_t seq = __atomic_load_n(&page->seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  page->version = kLockRecordVersion;
+  page->pid = static_cast<int32_t>(record.pid);
+  page->start_time = record.start_time;
+  copy_field(page->boot_id, sizeof(page->boot_id), record.boot_id);
+  page->exe_dev = record.exe_dev;
+  page->exe_ino = record.exe_ino;
+  page->window_id = record.window_id;
+  copy_field(page->display, sizeof(page->display), record.display);
+  copy_field(page->ipc_address, sizeof(page->ipc_address), record.ipc_address);
+  page->checksum = record_checksum(*page);
+
+  __atomic_store_n(&page->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+}  // namespace
+
+int acquire_file_lock(const std::string& path, int* held_fd) {
+  if (held_fd) *held_fd = -1;
+  for (int attempt = 0; attempt < kFileLockAttempts; attempt++) {
+    int fd = open(path.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+      int error = errno;
+      if (error == EWOULDBLOCK && held_fd) {
+        *held_fd = fd;
+      } else {
+        close(fd);
+      }
+      errno = error;
+      return -1;
+    }
+
+    // The previous owner unlinks before unlocking, so a file we opened
+    // before that may be locked by now but gone from path.
+    struct stat locked, current;
+    if (fstat(fd, &locked) == 0 && lstat(path.c_str(), &current) == 0 &&
+        locked.st_dev == current.st_dev && locked.st_ino == current.st_ino) {
+      return fd;
+    }
+    close(fd);
+  }
+  errno = EWOULDBLOCK;
+  return -1;
+}
+
+bool release_file_lock(const std::string& path, int fd) {
+  bool unlinked = unlink(path.c_str()) == 0 || errno == ENOENT;
+  // Closing the last description drops the flock.
+  close(fd);
+  return unlinked;
+}
+
+int acquire_lock_slot(int fd, int slot_count) {
+  for (int slot = 0; slot < slot_count; slot++) {
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = static_cast<off_t>(slot) * kLockSlotSize;
+    lock.l_len = kLockSlotSize;
+    // l_pid must be 0 for OFD locks.
+    if (fcntl(fd, F_OFD_SETLK, &lock) == 0) return slot;
+    if (errno != EAGAIN && errno != EACCES) return -1;
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+bool write_lock_slot(int fd, int slot, const LockSlotRecord& record, bool sync) {
+  char buf[kLockSlotSize] = {};
+  if (record.pid > 0) {
+    uint32_t magic = kLockSlotMagic;
+    int32_t pid = static_cast<int32_t>(record.pid);
+    memcpy(buf + kSlotMagicOffset, &magic, sizeof(magic));
+    memcpy(buf + kSlotPidOffset, &pid, sizeof(pid));
+    memcpy(buf + kSlotLastActiveOffset, &record.last_active_ms, sizeof(record.last_active_ms));
+    memcpy(buf + kSlotWindowOffset, &record.window_id, sizeof(record.window_id));
+  }
+  off_t offset = static_cast<off_t>(slot) * kLockSlotSize;
+  if (pwrite(fd, buf, sizeof(buf), offset) != static_cast<ssize_t>(sizeof(buf))) return false;
+  if (sync) fdatasync(fd);
+  return true;
+}
+
+std::vector<LockSlotRecord> read_lock_slots(int fd, int slot_count) {
+  std::vector<LockSlotRecord> records(slot_count);
+  std::vector<char> buf(static_cast<size_t>(slot_count) * kLockSlotSize);
+  ssize_t n = pread(fd, buf.data(), buf.size(), 0);
+  if (n <= 0) return records;
+
+  for (int slot = 0; slot < slot_count; slot++) {
+    size_t base = static_cast<size_t>(slot) * kLockSlotSize;
+    if (base + kLockSlotSize > static_cast<size_t>(n)) break;
+    uint32_t magic = 0;
+    int32_t pid = 0;
+    memcpy(&magic, buf.data() + base + kSlotMagicOffset, sizeof(magic));
+    if (magic != kLockSlotMagic) continue;
+    memcpy(&pid, buf.data() + base + kSlotPidOffset, sizeof(pid));
+    records[slot].pid = pid;
+    memcpy(&records[slot].last_active_ms, buf.data() + base + kSlotLastActiveOffset,
+           sizeof(records[slot].last_active_ms));
+    memcpy(&records[slot].window_id, buf.data() + base + kSlotWindowOffset,
+           sizeof(records[slot].window_id));
+  }
+  return records;
+}
+
+bool mark_lock_slot_active(int fd, int slot) {
+  int64_t last_active_ms = current_time_ms();
+  for (const LockSlotRecord& record : read_lock_slots(fd, kMaxLockSlots)) {
+    if (record.pid > 0 && record.last_active_ms >= last_active_ms) {
+      last_active_ms = record.last_active_ms + 1;
+    }
+  }
+  off_t offset = static_cast<off_t>(slot) * kLockSlotSize + kSlotLastActiveOffset;
+  return pwrite(fd, &last_active_ms, sizeof(last_active_ms), offset) ==
+         static_cast<ssize_t>(sizeof(last_active_ms));
+}
+
+int64_t current_time_ms() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+LockRecordPage* map_lock_record(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) return nullptr;
+  if (static_cast<size_t>(st.st_size) < kLockRecordSize &&
+      ftruncate(fd, kLockRecordSize) != 0) {
+    return nullptr;
+  }
+  void* page = mmap(nullptr, kLockRecordSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (page == MAP_FAILED) return nullptr;
+  return static_cast<LockRecordPage*>(page);
+}
+
+void publish_lock_record(LockRecordPage* page, const LockRecord& record, bool sync) {
+  write_record_fields(page, record);
+
+  // A stale record's magic stays valid throughout; only its text PID and
+  // fields change, and readers reject a mismatched checksum.
+  char text_pid[sizeof(page->text_pid)] = {};
+  snprintf(text_pid, sizeof(text_pid), "%d\n", static_cast<int>(record.pid));
+  memcpy(page->text_pid, text_pid, sizeof(text_pid));
+  __atomic_store_n(&page->magic, kLockRecordMagic, __ATOMIC_RELEASE);
+  memset(page->reserved, 0, sizeof(page->reserved));
+
+  if (sync) msync(page, kLockRecordSize, MS_SYNC);
+}
+
+void set_lock_record_window(LockRecordPage* page, uint64_t window_id) {
+  LockRecord record;
+  record.pid = page->pid;
+  record.start_time = page->start_time;
+  record.boot_id = read_field(page->boot_id, sizeof(page->boot_id));
+  record.exe_dev = page->exe_dev;
+  record.exe_ino = page->exe_ino;
+  record.window_id = window_id;
+  record.display = read_field(page->display, sizeof(page->display));
+  record.ipc_address = read_field(page->ipc_address, sizeof(page->ipc_address));
+  write_record_fields(page, record);
+}
+
+void unmap_lock_record(LockRecordPage* page) {
+  if (page) munmap(page, kLockRecordSize);
+}
+
+bool read_lock_record(int fd, LockRecord* record) {
+  // pread rather than mmap: a reader's mapping would fault with SIGBUS if
+  // an older version truncated the file while it was being read.
+  LockRecordPage page;
+  for (int attempt = 0; attempt < kLockRecordReadAttempts; attempt++) {
+    memset(&page, 0, sizeof(page));
+    ssize_t n = pread(fd, &page, sizeof(page), 0);
+    if (n <= 0) return false;
+
+    if (static_cast<size_t>(n) == sizeof(page) && page.magic == kLockRecordMagic) {
+      if (page.version != kLockRecordVersion) break;
+      // Odd seq or a torn copy: the owner was mid-update.
+      if ((page.seq & 1) || page.checksum != record_checksum(page)) continue;
+      *record = LockRecord();
+      record->pid = page.pid;
+      record->start_time = page.start_time;
+      record->boot_id = read_field(page.boot_id, sizeof(page.boot_id));
+      record->exe_dev = page.exe_dev;
+      record->exe_ino = page.exe_ino;
+      record->window_id = page.window_id;
+      record->display = read_field(page.display, sizeof(page.display));
+      record->ipc_address = read_field(page.ipc_address, sizeof(page.ipc_address));
+      record->versioned = true;
+      return record->pid > 0;
+    }
+    break;
+  }
+
+  // Legacy text record, or the text PID of a newer version.
+  char buf[sizeof(page.text_pid)];
+  memcpy(buf, &page, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  char* end = nullptr;
+  long pid = strtol(buf, &end, 10);
+  if (end == buf || pid <= 0) return false;
+  *record = LockRecord();
+  record->pid = static_cast<pid_t>(pid);
+  return true;
+}
+
+}  // namespace flutter_alone
@@ -0,0 +1,113 @@
+#ifndef FLUTTER_PLUGIN_LOCK_UTILS_H_
+#define FLUTTER_PLUGIN_LOCK_UTILS_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace flutter_alone {
+
+// Takes the whole-file lock of the single-instance mode: opens path
+// (creating it, never following a symlink) and flocks it exclusively
+// without blocking. Since release unlinks the file, a lock that ends up on
+// a file no longer at path (unlinked or replaced meanwhile) is dropped and
+// the open retried, so the returned fd always locks the current file.
+// Returns the locked fd, or -1 with errno set: EWOULDBLOCK when another
+// process holds the lock, in which case *held_fd (if non-null) receives an
+// fd open on the held file for reading its record.
+int acquire_file_lock(const std::string& path, int* held_fd);
+
+// Releases a lock taken by acquire_file_lock(): unlinks path while still
+// holding the lock, then closes fd. Unlinking after unlocking would let a
+// new owner lock the old file just before it disappears, while a third
+// process creates and locks a fresh one. Returns false when unlink failed
+// for a reason other than ENOENT.
+bool release_file_lock(const std::string& path, int fd);
+
+// Slot layout used when LinuxConfig.maxInstances > 1. Slot i is the byte
+// range [i * kLockSlotSize, (i + 1) * kLockSlotSize) of the lock file. It is
+// claimed with an open-file-description (F_OFD_SETLK) write lock on that
+// range and holds its owner's LockSlotRecord.
+constexpr int kMaxLockSlots = 64;
+constexpr size_t kLockSlotSize = 64;
+
+struct LockSlotRecord {
+  // Owner PID, or 0 for a slot that was released or never used.
+  pid_t pid = 0;
+  // CLOCK_REALTIME milliseconds of the owner's last activation; the
+  // least-recently-active owner receives the next rejected launch.
+  int64_t last_active_ms = 0;
+  // Owner's top-level X11 window once it is realized, or 0.
+  uint64_t window_id = 0;
+};
+
+// Claims the first free slot with one non-blocking F_OFD_SETLK per slot.
+// Returns the slot index, or -1 with errno set (EAGAIN or EACCES when all
+// slots are held). The lock lives as long as the open file description.
+int acquire_lock_slot(int fd, int slot_count);
+
+// Writes record into slot, followed by fdatasync when sync is set.
+bool write_lock_slot(int fd, int slot, const LockSlotRecord& record, bool sync);
+
+// Reads the records of all slots with a single pread. Slots past the end of
+// the file or without a valid record read as empty.
+std::vector<LockSlotRecord> read_lock_slots(int fd, int slot_count);
+
+// Marks slot as the most recently activated by rewriting only its
+// last_active_ms: the current time, or just past the newest record when
+// that is later (several activations within one millisecond), so the next
+// rejected launch goes to another slot.
+bool mark_lock_slot_active(int fd, int slot);
+
+int64_t current_time_ms();
+
+// Single-instance lock files (maxInstances == 1) start with a fixed-size,
+// versioned binary record that the owner keeps mapped and updates under a
+// seqlock, so the file never shrinks or reads as empty while it is locked.
+// Its first bytes still hold the decimal PID followed by a newline, which
+// is all that older versions read.
+constexpr size_t kLockRecordSize = 512;
+
+struct LockRecord {
+  pid_t pid = 0;
+  // See get_process_start_time().
+  uint64_t start_time = 0;
+  std::string boot_id;
+  // Device and inode of the owner's executable.
+  uint64_t exe_dev = 0;
+  uint64_t exe_ino = 0;
+  // Owner's $DISPLAY; window_id is only meaningful on that display.
+  std::string display;
+  uint64_t window_id = 0;
+  // Abstract socket name of the owner's launch endpoint.
+  std::string ipc_address;
+  // False for a record written by an older version: only pid is set.
+  bool versioned = false;
+};
+
+// The record page of a lock file, as mapped by its owner.
+struct LockRecordPage;
+
+// Grows the locked fd to kLockRecordSize if needed and maps the record
+// shared and writable. Returns null with errno set on failure.
+LockRecordPage* map_lock_record(int fd);
+
+// Publishes record (version 1) into page; msync()s it when sync is set.
+void publish_lock_record(LockRecordPage* page, const LockRecord& record, bool sync);
+
+// Republishes the record in page with window_id replaced.
+void set_lock_record_window(LockRecordPage* page, uint64_t window_id);
+
+void unmap_lock_record(LockRecordPage* page);
+
+// Reads the record of a lock file with one pread, retrying while the owner
+// is mid-update. Falls back to a legacy decimal PID. Returns false when the
+// file holds neither.
+bool read_lock_record(int fd, LockRecord* record);
+
+}  // namespace flutter_alone
+
+#endif  // FLUTTER_PLUGIN_LOCK_UTILS_H_
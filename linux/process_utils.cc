@@ -0,0 +1,291 @@
+#include "process_utils.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace flutter_alone {
+
+namespace {
+
+constexpr char kDeletedSuffix[] = " (deleted)";
+
+// Target of /proc/<pid>/exe without the " (deleted)" suffix the kernel
+// appends once the file is replaced, or "".
+std::string read_executable_path(pid_t pid) {
+  char path[64];
+  if (pid > 0) {
+    snprintf(path, sizeof(path), "/proc/%d/exe", static_cast<int>(pid));
+  } else {
+    snprintf(path, sizeof(path), "/proc/self/exe");
+  }
+  char target[PATH_MAX];
+  ssize_t len = readlink(path, target, sizeof(target) - 1);
+  if (len < 0) return std::string();
+  std::string result(target, static_cast<size_t>(len));
+  size_t suffix_len = sizeof(kDeletedSuffix) - 1;
+  if (result.size() > suffix_len &&
+      result.compare(result.size() - suffix_len, suffix_len, kDeletedSuffix) == 0) {
+    result.resize(result.size() - suffix_len);
+  }
+  return result;
+}
+
+// Value of name in pid's initial environment, or "". Readable for our own
+// user's processes only.
+std::string read_process_env(pid_t pid, const std::string& name) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/environ", static_cast<int>(pid));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return std::string();
+  std::string environ;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) environ.append(buf, static_cast<size_t>(n));
+  close(fd);
+
+  std::string prefix = name + "=";
+  size_t start = 0;
+  while (start < environ.size()) {
+    size_t end = environ.find('\0', start);
+    if (end == std::string::npos) end = environ.size();
+    if (environ.compare(start, prefix.size(), prefix) == 0) {
+      return environ.substr(start + prefix.size(), end - start - prefix.size());
+    }
+    start = end + 1;
+  }
+  return std::string();
+}
+
+ExecutableIdentity read_self_executable() {
+  ExecutableIdentity identity;
+  struct stat st;
+  if (stat("/proc/self/exe", &st) == 0) {
+    identity.dev = static_cast<uint64_t>(st.st_dev);
+    identity.ino = static_cast<uint64_t>(st.st_ino);
+  }
+  identity.path = read_executable_path(0);
+  const char* appimage = getenv("APPIMAGE");
+  if (appimage) identity.appimage = appimage;
+  return identity;
+}
+
+}  // namespace
+
+uint64_t get_process_start_time(pid_t pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return 0;
+  char buf[1024];
+  ssize_t n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (n <= 0) return 0;
+  buf[n] = '\0';
+
+  // comm (field 2) may contain spaces and parentheses; fields after it
+  // start past the last ')'.
+  const char* p = strrchr(buf, ')');
+  if (!p) return 0;
+  p++;
+  // p now points before field 3 (state); starttime is field 22.
+  for (int field = 3; field < 22; field++) {
+    p = strchr(p + 1, ' ');
+    if (!p) return 0;
+  }
+  return strtoull(p + 1, nullptr, 10);
+}
+
+std::string get_boot_id() {
+  int fd = open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return std::string();
+  char buf[64];
+  ssize_t n = read(fd, buf, sizeof(buf));
+  close(fd);
+  if (n <= 0) return std::string();
+  std::string id(buf, static_cast<size_t>(n));
+  while (!id.empty() && (id.back() == '\n' || id.back() == '\0')) id.pop_back();
+  return id;
+}
+
+bool get_executable_id(pid_t pid, uint64_t* dev, uint64_t* ino) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/exe", static_cast<int>(pid));
+  struct stat st;
+  if (stat(path, &st) != 0) return false;
+  *dev = static_cast<uint64_t>(st.st_dev);
+  *ino = static_cast<uint64_t>(st.st_ino);
+  return true;
+}
+
+int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+const ExecutableIdentity& get_self_executable() {
+  static const ExecutableIdentity identity = read_self_executable();
+  return identity;
+}
+
+int64_t monotonic_time_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool wait_for_child(pid_t child, int timeout_ms, int* status) {
+  int64_t deadline = monotonic_time_us() + static_cast<int64_t>(timeout_ms) * 1000;
+
+  int pidfd = open_pidfd(child);
+  if (pidfd >= 0) {
+    int ret;
+    do {
+      int64_t remaining_ms = (deadline - monotonic_time_us() + 999) / 1000;
+      if (remaining_ms < 0) remaining_ms = 0;
+      pollfd pfd = {pidfd, POLLIN, 0};
+      ret = poll(&pfd, 1, static_cast<int>(remaining_ms));
+    } while (ret < 0 && errno == EINTR);
+    close(pidfd);
+    // Readable pidfd: the child has exited, so waitpid does not block.
+    return ret > 0 && waitpid(child, status, 0) == child;
+  }
+
+  // No pidfd (kernel older than 5.3): poll with WNOHANG.
+  for (;;) {
+    pid_t ret = waitpid(child, status, WNOHANG);
+    if (ret == child) return true;
+    if (ret < 0 && errno != EINTR) return false;
+    if (monotonic_time_us() >= deadline) return false;
+    usleep(10 * 1000);
+  }
+}
+
+bool run_command(const char* prog, char* const argv[], int timeout_ms) {
+  pid_t child_pid;
+  int status = 0;
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+
+  if (posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0) != 0 ||
+      posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) != 0) {
+    posix_spawn_file_actions_destroy(&actions);
+    return false;
+  }
+
+  int ret = posix_spawnp(&child_pid, prog, &actions, nullptr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+
+  if (ret != 0) {
+    errno = ret;
+    return false;
+  }
+
+  if (!wait_for_child(child_pid, timeout_ms, &status)) {
+    kill(child_pid, SIGKILL);
+    waitpid(child_pid, &status, 0);
+    errno = ETIMEDOUT;
+    return false;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool is_same_program(pid_t pid) {
+  const ExecutableIdentity& self = get_self_executable();
+  uint64_t dev = 0, ino = 0;
+  if (!get_executable_id(pid, &dev, &ino)) return false;
+  if (dev == self.dev && ino == self.ino) return true;
+
+  if (!self.path.empty() && read_executable_path(pid) == self.path) return true;
+  return !self.appimage.empty() && read_process_env(pid, "APPIMAGE") == self.appimage;
+}
+
+ProcessHandle ProcessHandle::Open(pid_t pid, uint64_t start_time) {
+  ProcessHandle handle;
+  if (pid <= 0) return handle;
+  int pidfd = open_pidfd(pid);
+  if (pidfd < 0 && errno != ENOSYS && errno != EPERM) return handle;
+
+  // Checked after the pidfd exists, so a match proves the pidfd refers to
+  // the process that started at start_time.
+  uint64_t actual = get_process_start_time(pid);
+  if (actual == 0 || (start_time != 0 && actual != start_time)) {
+    if (pidfd >= 0) close(pidfd);
+    return handle;
+  }
+  handle.pid_ = pid;
+  handle.pidfd_ = pidfd;
+  handle.start_time_ = actual;
+  return handle;
+}
+
+ProcessHandle::~ProcessHandle() {
+  if (pidfd_ >= 0) close(pidfd_);
+}
+
+ProcessHandle::ProcessHandle(ProcessHandle&& other) noexcept
+    : pid_(std::exchange(other.pid_, 0)),
+      pidfd_(std::exchange(other.pidfd_, -1)),
+      start_time_(std::exchange(other.start_time_, 0)) {}
+
+ProcessHandle& ProcessHandle::operator=(ProcessHandle&& other) noexcept {
+  if (this != &other) {
+    if (pidfd_ >= 0) close(pidfd_);
+    pid_ = std::exchange(other.pid_, 0);
+    pidfd_ = std::exchange(other.pidfd_, -1);
+    start_time_ = std::exchange(other.start_time_, 0);
+  }
+  return *this;
+}
+
+bool ProcessHandle::IsAlive() const {
+  if (pid_ <= 0) return false;
+#ifdef SYS_pidfd_send_signal
+  if (pidfd_ >= 0) {
+    return syscall(SYS_pidfd_send_signal, pidfd_, 0, nullptr, 0) == 0 || errno == EPERM;
+  }
+#endif
+  return get_process_start_time(pid_) == start_time_;
+}
+
+bool ProcessHandle::WaitForExit(int timeout_ms) const {
+  if (pid_ <= 0) return true;
+  int64_t deadline = monotonic_time_us() + static_cast<int64_t>(timeout_ms) * 1000;
+  if (pidfd_ >= 0) {
+    for (;;) {
+      int64_t remaining_ms = (deadline - monotonic_time_us() + 999) / 1000;
+      if (remaining_ms < 0) remaining_ms = 0;
+      pollfd pfd = {pidfd_, POLLIN, 0};
+      int ret = poll(&pfd, 1, static_cast<int>(remaining_ms));
+      if (ret > 0) return true;
+      if (ret == 0 || errno != EINTR) return false;
+    }
+  }
+  for (;;) {
+    if (!IsAlive()) return true;
+    if (monotonic_time_us() >= deadline) return false;
+    usleep(10 * 1000);
+  }
+}
+
+}  // namespace flutter_alone
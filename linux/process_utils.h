@@ -0,0 +1,101 @@
+#ifndef FLUTTER_PLUGIN_PROCESS_UTILS_H_
+#define FLUTTER_PLUGIN_PROCESS_UTILS_H_
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+
+namespace flutter_alone {
+
+// Start time of pid in clock ticks since boot (field 22 of
+// /proc/<pid>/stat), or 0 when the process does not exist. Together with
+// the PID it identifies a process across PID reuse.
+uint64_t get_process_start_time(pid_t pid);
+
+// Kernel boot id (/proc/sys/kernel/random/boot_id), or "" when unavailable.
+// Records carrying another boot id were written before a reboot.
+std::string get_boot_id();
+
+// Device and inode of pid's executable (stat of /proc/<pid>/exe). Returns
+// false when the process does not exist or is not ours to inspect.
+bool get_executable_id(pid_t pid, uint64_t* dev, uint64_t* ino);
+
+// pidfd_open(2). Returns -1 with errno set; ENOSYS before Linux 5.3 or when
+// built against headers that predate it.
+int open_pidfd(pid_t pid);
+
+// Identity of our own executable, read on first use and cached for the
+// life of the process (the running image cannot change underneath us).
+struct ExecutableIdentity {
+  uint64_t dev = 0;
+  uint64_t ino = 0;
+  // Target of /proc/self/exe.
+  std::string path;
+  // $APPIMAGE: the image file, whose mount point differs per launch.
+  std::string appimage;
+};
+
+const ExecutableIdentity& get_self_executable();
+
+// True when pid runs the same program as we do. Usually a single stat of
+// /proc/<pid>/exe (dev/inode match, which also holds across bind mounts).
+// Otherwise the owner may be running a binary that has since been upgraded
+// in place (its exe link ends in " (deleted)") or the same AppImage from
+// another mount point; both are matched by path.
+bool is_same_program(pid_t pid);
+
+// Monotonic clock in microseconds (CLOCK_MONOTONIC, as g_get_monotonic_time).
+int64_t monotonic_time_us();
+
+// Waits up to timeout_ms for child to exit and reaps it. Returns false on
+// timeout, leaving the child running.
+bool wait_for_child(pid_t child, int timeout_ms, int* status);
+
+// posix_spawnp()s prog with stdout and stderr on /dev/null and waits up to
+// timeout_ms for it. Returns true when it exited with status 0. A child
+// still running at the deadline is killed and reaped, and false is
+// returned with errno set to ETIMEDOUT.
+bool run_command(const char* prog, char* const argv[], int timeout_ms);
+
+// A process pinned with a pidfd for a check-then-act sequence: once Open()
+// has verified the start time, IsAlive() keeps referring to that exact
+// process even if its PID is reused later. Without pidfd support it falls
+// back to kill(0) plus a start time re-check.
+class ProcessHandle {
+ public:
+  // start_time 0 skips the start time check (e.g. owners that predate the
+  // binary lock record). The handle is invalid when the process is gone or
+  // is not the one that started at start_time.
+  static ProcessHandle Open(pid_t pid, uint64_t start_time);
+
+  ProcessHandle() = default;
+  ~ProcessHandle();
+  ProcessHandle(ProcessHandle&& other) noexcept;
+  ProcessHandle& operator=(ProcessHandle&& other) noexcept;
+  ProcessHandle(const ProcessHandle&) = delete;
+  ProcessHandle& operator=(const ProcessHandle&) = delete;
+
+  bool valid() const { return pid_ > 0; }
+  pid_t pid() const { return pid_; }
+
+  bool IsAlive() const;
+
+  // The pidfd, readable once the process exits, or -1 when the kernel has
+  // no pidfd_open (then only IsAlive() and WaitForExit() work).
+  int fd() const { return pidfd_; }
+
+  // Blocks until the process exits or timeout_ms elapses; returns true once
+  // it has exited. A poll() on the pidfd, so the wakeup is immediate;
+  // without one, liveness is rechecked every 10 ms.
+  bool WaitForExit(int timeout_ms) const;
+
+ private:
+  pid_t pid_ = 0;
+  int pidfd_ = -1;
+  uint64_t start_time_ = 0;
+};
+
+}  // namespace flutter_alone
+
+#endif  // FLUTTER_PLUGIN_PROCESS_UTILS_H_
@@ -0,0 +1,251 @@
+#include "registry_utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ipc_utils.h"
+#include "process_utils.h"
+
+namespace flutter_alone {
+
+namespace {
+
+constexpr uint32_t kRegistryMagic = 0x47524C46;  // "FLRG"
+constexpr uint32_t kRegistryVersion = 1;
+
+// Longest lock name used verbatim in the shm name; longer ones are hashed.
+constexpr size_t kMaxRegistryNameLength = 200;
+
+// Shared layout. Every field is only accessed through __atomic builtins or
+// under the entry's seqlock.
+struct RegistryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t entry_size;
+};
+
+struct RegistryEntry {
+  // Odd while the owner is rewriting the fields below.
+  uint32_t seq;
+  // 0 when free, -1 while being reclaimed; claimed with a CAS from 0.
+  int32_t pid;
+  uint64_t start_time;
+  uint64_t window_id;
+  uint32_t flags;
+  int32_t slot;
+  char endpoint[108];
+};
+
+RegistryHeader* header_of(void* base) {
+  return static_cast<RegistryHeader*>(base);
+}
+
+RegistryEntry* entry_at(void* base, int index) {
+  return reinterpret_cast<RegistryEntry*>(static_cast<char*>(base) + sizeof(RegistryHeader)) +
+         index;
+}
+
+size_t registry_size() {
+  return sizeof(RegistryHeader) + sizeof(RegistryEntry) * kRegistryCapacity;
+}
+
+std::string make_registry_name(const std::string& lock_file_name) {
+  std::string prefix = "/flutter_alone." + std::to_string(getuid()) + ".";
+  if (lock_file_name.size() <= kMaxRegistryNameLength) return prefix + lock_file_name;
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx",
+           static_cast<unsigned long long>(fnv1a_64(lock_file_name)));
+  return prefix + hash;
+}
+
+}  // namespace
+
+std::unique_ptr<InstanceRegistry> InstanceRegistry::Open(const std::string& lock_file_name) {
+  std::string name = make_registry_name(lock_file_name);
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) return nullptr;
+
+  // The name is predictable, so refuse an object planted by another user.
+  size_t size = registry_size();
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_uid != getuid() ||
+      (static_cast<size_t>(st.st_size) < size && ftruncate(fd, size) != 0)) {
+    close(fd);
+    return nullptr;
+  }
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) return nullptr;
+
+  // New objects are zero-filled. Every creator writes the same values, and
+  // the magic goes last so readers never see a half-initialized header.
+  RegistryHeader* header = header_of(base);
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == 0) {
+    __atomic_store_n(&header->version, kRegistryVersion, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->capacity, static_cast<uint32_t>(kRegistryCapacity),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&header->entry_size, static_cast<uint32_t>(sizeof(RegistryEntry)),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&header->magic, kRegistryMagic, __ATOMIC_RELEASE);
+  }
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != kRegistryMagic ||
+      __atomic_load_n(&header->version, __ATOMIC_RELAXED) != kRegistryVersion ||
+      __atomic_load_n(&header->capacity, __ATOMIC_RELAXED) != kRegistryCapacity ||
+      __atomic_load_n(&header->entry_size, __ATOMIC_RELAXED) != sizeof(RegistryEntry)) {
+    munmap(base, size);
+    return nullptr;
+  }
+  return std::unique_ptr<InstanceRegistry>(new InstanceRegistry(base, size));
+}
+
+InstanceRegistry::InstanceRegistry(void* base, size_t size) : base_(base), size_(size) {}
+
+InstanceRegistry::~InstanceRegistry() {
+  munmap(base_, size_);
+}
+
+int InstanceRegistry::Register(const InstanceInfo& info) {
+  // Second pass runs after List() has reclaimed entries of dead processes.
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < kRegistryCapacity; i++) {
+      int32_t expected = 0;
+      if (__atomic_compare_exchange_n(&entry_at(base_, i)->pid, &expected,
+                                      static_cast<int32_t>(info.pid), false,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        WriteEntry(i, info);
+        return i;
+      }
+    }
+    List();
+  }
+  return -1;
+}
+
+void InstanceRegistry::Update(int index, const InstanceInfo& info) {
+  if (index < 0 || index >= kRegistryCapacity) return;
+  WriteEntry(index, info);
+}
+
+void InstanceRegistry::SetWindow(int index, uint64_t window_id) {
+  InstanceInfo info;
+  if (index < 0 || index >= kRegistryCapacity || !ReadEntry(index, &info)) return;
+  info.window_id = window_id;
+  if (window_id) {
+    info.flags |= kInstanceFlagWindowReady;
+  } else {
+    info.flags &= ~kInstanceFlagWindowReady;
+  }
+  WriteEntry(index, info);
+}
+
+void InstanceRegistry::Unregister(int index) {
+  if (index < 0 || index >= kRegistryCapacity) return;
+  WriteEntry(index, InstanceInfo());
+  __atomic_store_n(&entry_at(base_, index)->pid, 0, __ATOMIC_RELEASE);
+}
+
+std::vector<InstanceInfo> InstanceRegistry::List() {
+  std::vector<InstanceInfo> instances;
+  for (int i = 0; i < kRegistryCapacity; i++) {
+    InstanceInfo info;
+    if (!ReadEntry(i, &info)) continue;
+    if (IsLive(info)) {
+      // start_time 0: claimed, fields not yet published.
+      if (info.start_time != 0) instances.push_back(info);
+    } else {
+      Reclaim(i, info.pid);
+    }
+  }
+  return instances;
+}
+
+bool InstanceRegistry::FindPrimary(InstanceInfo* info) {
+  for (int i = 0; i < kRegistryCapacity; i++) {
+    InstanceInfo entry;
+    if (!ReadEntry(i, &entry) || !(entry.flags & kInstanceFlagPrimary)) continue;
+    if (!IsLive(entry)) {
+      Reclaim(i, entry.pid);
+      continue;
+    }
+    *info = entry;
+    return true;
+  }
+  return false;
+}
+
+bool InstanceRegistry::ReadEntry(int index, InstanceInfo* info) const {
+  RegistryEntry* entry = entry_at(base_, index);
+  for (int attempt = 0; attempt < 8; attempt++) {
+    uint32_t seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) continue;
+
+    int32_t pid = __atomic_load_n(&entry->pid, __ATOMIC_RELAXED);
+    if (pid <= 0) return false;
+    info->pid = pid;
+    info->start_time = __atomic_load_n(&entry->start_time, __ATOMIC_RELAXED);
+    info->window_id = __atomic_load_n(&entry->window_id, __ATOMIC_RELAXED);
+    info->flags = __atomic_load_n(&entry->flags, __ATOMIC_RELAXED);
+    info->slot = __atomic_load_n(&entry->slot, __ATOMIC_RELAXED);
+    char endpoint[sizeof(entry->endpoint)];
+    for (size_t i = 0; i < sizeof(endpoint); i++) {
+      endpoint[i] = __atomic_load_n(&entry->endpoint[i], __ATOMIC_RELAXED);
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq) continue;
+    info->endpoint.assign(endpoint, strnlen(endpoint, sizeof(endpoint)));
+    return true;
+  }
+  return false;
+}
+
+void InstanceRegistry::WriteEntry(int index, const InstanceInfo& info) {
+  RegistryEntry* entry = entry_at(base_, index);
+  uint32_t seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  __atomic_store_n(&entry->start_time, info.start_time, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->window_id, info.window_id, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->flags, info.flags, __ATOMIC_RELAXED);
+  __atomic_store_n(&entry->slot, info.slot, __ATOMIC_RELAXED);
+  size_t length = std::min(info.endpoint.size(), sizeof(entry->endpoint) - 1);
+  for (size_t i = 0; i < sizeof(entry->endpoint); i++) {
+    char c = i < length ? info.endpoint[i] : '\0';
+    __atomic_store_n(&entry->endpoint[i], c, __ATOMIC_RELAXED);
+  }
+
+  __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+bool InstanceRegistry::IsLive(const InstanceInfo& info) const {
+  if (info.start_time == 0) {
+    // Being registered: stale only if the claimant is gone.
+    return kill(info.pid, 0) == 0 || errno == EPERM;
+  }
+  return get_process_start_time(info.pid) == info.start_time;
+}
+
+void InstanceRegistry::Reclaim(int index, pid_t pid) {
+  // Only one reclaimer wins; a new claimant can only take the entry once
+  // pid is back to 0.
+  int32_t expected = static_cast<int32_t>(pid);
+  RegistryEntry* entry = entry_at(base_, index);
+  if (!__atomic_compare_exchange_n(&entry->pid, &expected, -1, false,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+    return;
+  }
+  WriteEntry(index, InstanceInfo());
+  __atomic_store_n(&entry->pid, 0, __ATOMIC_RELEASE);
+}
+
+}  // namespace flutter_alone
@@ -0,0 +1,91 @@
+#ifndef FLUTTER_PLUGIN_REGISTRY_UTILS_H_
+#define FLUTTER_PLUGIN_REGISTRY_UTILS_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace flutter_alone {
+
+// InstanceInfo::flags
+// Holds the lock (or one of its slots).
+constexpr uint32_t kInstanceFlagPrimary = 1u << 0;
+// Serves the launch endpoint named in InstanceInfo::endpoint.
+constexpr uint32_t kInstanceFlagAcceptsLaunches = 1u << 1;
+// InstanceInfo::window_id is set.
+constexpr uint32_t kInstanceFlagWindowReady = 1u << 2;
+
+// Number of entries in a registry mapping.
+constexpr int kRegistryCapacity = 64;
+
+struct InstanceInfo {
+  pid_t pid = 0;
+  // See get_process_start_time(); guards against PID reuse.
+  uint64_t start_time = 0;
+  // Top-level X11 window, or 0.
+  uint64_t window_id = 0;
+  uint32_t flags = 0;
+  // Lock slot (maxInstances > 1), or -1.
+  int32_t slot = -1;
+  // Abstract socket name of the launch endpoint, without the leading NUL.
+  std::string endpoint;
+};
+
+// Per-user shared-memory table of the running instances of one lock name
+// (POSIX shm, "/flutter_alone.<uid>.<lock name>"). Every instance maps the
+// same pages, so finding and verifying the primary is a read of the mapping:
+// no lock file parsing and no window enumeration. Each entry is written
+// under its own seqlock; entries of processes that died without
+// unregistering are reclaimed by whoever notices.
+class InstanceRegistry {
+ public:
+  // Maps the registry for lock_file_name, creating it if needed. Returns
+  // null when shared memory is unavailable or the object belongs to another
+  // user.
+  static std::unique_ptr<InstanceRegistry> Open(const std::string& lock_file_name);
+
+  ~InstanceRegistry();
+
+  InstanceRegistry(const InstanceRegistry&) = delete;
+  InstanceRegistry& operator=(const InstanceRegistry&) = delete;
+
+  // Claims a free entry for info.pid and publishes info. Returns the entry
+  // index, or -1 when the table is full.
+  int Register(const InstanceInfo& info);
+
+  // Republishes an entry owned by the caller.
+  void Update(int index, const InstanceInfo& info);
+
+  // Publishes window_id in an entry owned by the caller and sets
+  // kInstanceFlagWindowReady (cleared again for 0).
+  void SetWindow(int index, uint64_t window_id);
+
+  void Unregister(int index);
+
+  // Returns the live entries, reclaiming stale ones.
+  std::vector<InstanceInfo> List();
+
+  // Finds a live entry flagged kInstanceFlagPrimary.
+  bool FindPrimary(InstanceInfo* info);
+
+ private:
+  InstanceRegistry(void* base, size_t size);
+
+  // Copies entry index into info if it is in use and consistent.
+  bool ReadEntry(int index, InstanceInfo* info) const;
+  void WriteEntry(int index, const InstanceInfo& info);
+  // True when info belongs to a process that is still running.
+  bool IsLive(const InstanceInfo& info) const;
+  void Reclaim(int index, pid_t pid);
+
+  void* base_;
+  size_t size_;
+};
+
+}  // namespace flutter_alone
+
+#endif  // FLUTTER_PLUGIN_REGISTRY_UTILS_H_
@@ -0,0 +1,342 @@
+#include "instance_lock.h"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ipc_utils.h"
+
+namespace flutter_alone {
+namespace {
+
+class InstanceLockTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/flutter_alone_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+    name_ = "instance_lock_test." + std::to_string(getpid()) + ".lock";
+  }
+
+  void TearDown() override {
+    unlink((dir_ + "/" + name_).c_str());
+    rmdir(dir_.c_str());
+  }
+
+  LockTarget FileTarget(int max_instances = 1) {
+    return get_lock_target(LockMode::kFile, LockDirectory::kSystemTemp, dir_.c_str(),
+                           name_.c_str(), max_instances);
+  }
+
+  void Release(const LockTarget& target, const LockAttempt& attempt) {
+    EXPECT_TRUE(release_instance_lock(target.mode, target.path, attempt.fd, attempt.slot,
+                                      attempt.record));
+  }
+
+  std::string dir_;
+  std::string name_;
+  CheckDiagnostics diagnostics_;
+};
+
+TEST(LockTargetTest, ResolvesDirectories) {
+  LockTarget socket = get_lock_target(LockMode::kSocket, LockDirectory::kSystemTemp, nullptr,
+                                      "app.lock", 1);
+  EXPECT_EQ(socket.path, "@" + make_abstract_socket_name("app.lock", "lock"));
+  EXPECT_TRUE(socket.directory.empty());
+
+  LockTarget custom = get_lock_target(LockMode::kFile, LockDirectory::kRuntime, "/var/lock/app",
+                                      "app.lock", 1);
+  EXPECT_EQ(custom.path, "/var/lock/app/app.lock");
+  EXPECT_EQ(custom.directory_setup, DirectorySetup::kCreate);
+
+  // A relative override is ignored.
+  LockTarget relative = get_lock_target(LockMode::kFile, LockDirectory::kSystemTemp, "locks",
+                                        "app.lock", 1);
+  EXPECT_EQ(relative.directory_setup, DirectorySetup::kNone);
+  EXPECT_EQ(relative.path, relative.directory + "/app.lock");
+}
+
+TEST(LockTargetTest, ClampsSlotCount) {
+  EXPECT_EQ(get_lock_target(LockMode::kFile, LockDirectory::kSystemTemp, nullptr, "a", 1000)
+                .max_instances,
+            kMaxLockSlots);
+  EXPECT_EQ(get_lock_target(LockMode::kSocket, LockDirectory::kSystemTemp, nullptr, "a", 4)
+                .max_instances,
+            1);
+}
+
+TEST(LockTargetTest, ValidatesLockFileName) {
+  EXPECT_TRUE(is_valid_lock_file_name("app.lock"));
+  EXPECT_FALSE(is_valid_lock_file_name(nullptr));
+  EXPECT_FALSE(is_valid_lock_file_name(""));
+  EXPECT_FALSE(is_valid_lock_file_name("."));
+  EXPECT_FALSE(is_valid_lock_file_name(".."));
+  EXPECT_FALSE(is_valid_lock_file_name("../app.lock"));
+}
+
+TEST_F(InstanceLockTest, CreatesMissingDirectory) {
+  std::string nested = dir_ + "/a/b";
+  LockTarget target = get_lock_target(LockMode::kFile, LockDirectory::kSystemTemp,
+                                      nested.c_str(), name_.c_str(), 1);
+  LockAttempt attempt = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(attempt.status, LockStatus::kAcquired);
+  Release(target, attempt);
+  rmdir(nested.c_str());
+  rmdir((dir_ + "/a").c_str());
+}
+
+TEST_F(InstanceLockTest, SecondAttemptFindsOwner) {
+  LockTarget target = FileTarget();
+  LockAttempt first = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(first.status, LockStatus::kAcquired);
+  EXPECT_NE(first.record, nullptr);
+  EXPECT_FALSE(first.filesystem.empty());
+
+  LockAttempt second = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(second.status, LockStatus::kHeldByOther);
+  EXPECT_EQ(second.owner_pid, getpid());
+  EXPECT_EQ(second.owner_start_time, get_process_start_time(getpid()));
+
+  // The owner is ourselves: same program, so it verifies.
+  EXPECT_TRUE(verify_lock_owner(second, &diagnostics_).valid());
+
+  Release(target, first);
+  LockAttempt third = try_acquire_lock(target, &diagnostics_);
+  EXPECT_EQ(third.status, LockStatus::kAcquired);
+  Release(target, third);
+}
+
+TEST_F(InstanceLockTest, SlotModeAdmitsMaxInstances) {
+  LockTarget target = FileTarget(2);
+  LockAttempt first = try_acquire_lock(target, &diagnostics_);
+  LockAttempt second = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(first.status, LockStatus::kAcquired);
+  ASSERT_EQ(second.status, LockStatus::kAcquired);
+  EXPECT_NE(first.slot, second.slot);
+
+  LockAttempt third = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(third.status, LockStatus::kHeldByOther);
+  EXPECT_EQ(third.owner_pid, getpid());
+
+  Release(target, first);
+  Release(target, second);
+}
+
+TEST_F(InstanceLockTest, RejectedLaunchesRotateAcrossSlots) {
+  LockTarget target = FileTarget(3);
+  LockAttempt owners[3];
+  for (LockAttempt& owner : owners) {
+    owner = try_acquire_lock(target, &diagnostics_);
+    ASSERT_EQ(owner.status, LockStatus::kAcquired);
+  }
+
+  // Each launch goes to the least recently picked slot, even when the
+  // picks land within the same millisecond.
+  std::vector<int> picks;
+  for (int i = 0; i < 6; i++) {
+    LockAttempt launch = try_acquire_lock(target, &diagnostics_);
+    ASSERT_EQ(launch.status, LockStatus::kHeldByOther);
+    EXPECT_EQ(launch.owner_pid, getpid());
+    picks.push_back(launch.owner_slot);
+  }
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NE(picks[i], picks[(i + 1) % 3]);
+    EXPECT_EQ(picks[i], picks[i + 3]);
+  }
+
+  for (const LockAttempt& owner : owners) Release(target, owner);
+}
+
+TEST_F(InstanceLockTest, SocketModeFindsOwnerByPeerCredentials) {
+  LockTarget target = get_lock_target(LockMode::kSocket, LockDirectory::kSystemTemp, nullptr,
+                                      name_.c_str(), 1);
+  LockAttempt first = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(first.status, LockStatus::kAcquired);
+
+  LockAttempt second = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(second.status, LockStatus::kHeldByOther);
+  EXPECT_EQ(second.owner_pid, getpid());
+
+  Release(target, first);
+  EXPECT_EQ(try_acquire_lock(target, &diagnostics_).status, LockStatus::kAcquired);
+}
+
+TEST_F(InstanceLockTest, RegistryNamesPrimary) {
+  std::unique_ptr<InstanceRegistry> registry = InstanceRegistry::Open(name_);
+  ASSERT_NE(registry, nullptr);
+  ASSERT_GE(register_instance(registry.get(), name_, -1, true), 0);
+
+  LockAttempt attempt;
+  find_lock_owner(registry.get(), FileTarget(), &attempt);
+  EXPECT_EQ(attempt.owner_pid, getpid());
+  EXPECT_EQ(attempt.owner_start_time, get_process_start_time(getpid()));
+
+  // Slot mode picks from the lock file instead.
+  LockAttempt slot_attempt;
+  find_lock_owner(registry.get(), FileTarget(2), &slot_attempt);
+  EXPECT_EQ(slot_attempt.owner_pid, -1);
+
+  registry.reset();
+  shm_unlink(("/flutter_alone." + std::to_string(getuid()) + "." + name_).c_str());
+}
+
+// Forks a child that takes target's lock, then holds it for hold_ms (or
+// until release_fd is closed when hold_ms is negative) and exits. Returns
+// once the child holds the lock.
+pid_t fork_lock_holder(const LockTarget& target, int hold_ms, int* release_fd) {
+  int ready[2], release[2];
+  if (pipe(ready) != 0 || pipe(release) != 0) return -1;
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(ready[0]);
+    close(release[1]);
+    CheckDiagnostics diagnostics;
+    LockAttempt attempt = try_acquire_lock(target, &diagnostics);
+    char status = attempt.status == LockStatus::kAcquired ? 1 : 0;
+    if (write(ready[1], &status, 1) != 1 || !status) _exit(1);
+    if (hold_ms >= 0) {
+      usleep(static_cast<useconds_t>(hold_ms) * 1000);
+    } else {
+      char c;
+      while (read(release[0], &c, 1) < 0 && errno == EINTR) {}
+    }
+    // Exits without releasing: the kernel drops the lock.
+    _exit(0);
+  }
+  close(ready[1]);
+  close(release[0]);
+  char status = 0;
+  bool held = read(ready[0], &status, 1) == 1 && status == 1;
+  close(ready[0]);
+  *release_fd = release[1];
+  return held ? pid : -1;
+}
+
+TEST_F(InstanceLockTest, WaitForLockReturnsWhenOwnerExits) {
+  LockTarget target = FileTarget();
+  int release_fd = -1;
+  pid_t holder = fork_lock_holder(target, 200, &release_fd);
+  ASSERT_GT(holder, 0);
+
+  int64_t start = monotonic_time_us();
+  LockAttempt attempt = wait_for_lock(target, 5000, -1, &diagnostics_);
+  int64_t elapsed_ms = (monotonic_time_us() - start) / 1000;
+  EXPECT_EQ(attempt.status, LockStatus::kAcquired);
+  EXPECT_LT(elapsed_ms, 2000);
+
+  close(release_fd);
+  waitpid(holder, nullptr, 0);
+  if (attempt.status == LockStatus::kAcquired) Release(target, attempt);
+}
+
+TEST_F(InstanceLockTest, WaitForLockReturnsWhenAnySlotOwnerExits) {
+  LockTarget target = FileTarget(2);
+  int first_release_fd = -1, second_release_fd = -1;
+  // The first owner is the least recently active one a launch is routed
+  // to, and keeps its slot; only the second one exits.
+  pid_t first = fork_lock_holder(target, -1, &first_release_fd);
+  ASSERT_GT(first, 0);
+  pid_t second = fork_lock_holder(target, 200, &second_release_fd);
+  ASSERT_GT(second, 0);
+
+  int64_t start = monotonic_time_us();
+  LockAttempt attempt = wait_for_lock(target, 5000, -1, &diagnostics_);
+  int64_t elapsed_ms = (monotonic_time_us() - start) / 1000;
+  EXPECT_EQ(attempt.status, LockStatus::kAcquired);
+  EXPECT_LT(elapsed_ms, 2000);
+
+  close(first_release_fd);
+  close(second_release_fd);
+  waitpid(first, nullptr, 0);
+  waitpid(second, nullptr, 0);
+  if (attempt.status == LockStatus::kAcquired) Release(target, attempt);
+}
+
+TEST_F(InstanceLockTest, WaitForLockGivesUpAtDeadline) {
+  LockTarget target = FileTarget();
+  int release_fd = -1;
+  pid_t holder = fork_lock_holder(target, -1, &release_fd);
+  ASSERT_GT(holder, 0);
+
+  int64_t start = monotonic_time_us();
+  LockAttempt attempt = wait_for_lock(target, 150, -1, &diagnostics_);
+  int64_t elapsed_ms = (monotonic_time_us() - start) / 1000;
+  EXPECT_EQ(attempt.status, LockStatus::kHeldByOther);
+  EXPECT_EQ(attempt.owner_pid, holder);
+  EXPECT_GE(elapsed_ms, 150);
+
+  close(release_fd);
+  waitpid(holder, nullptr, 0);
+}
+
+TEST_F(InstanceLockTest, WaitForLockReturnsWhenOwnerReleases) {
+  LockTarget target = FileTarget();
+  LockAttempt held = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(held.status, LockStatus::kAcquired);
+
+  // The owner (this process) stays alive, so only the unlinked file can
+  // end the wait early.
+  std::thread owner([&] {
+    usleep(200 * 1000);
+    Release(target, held);
+  });
+  int64_t start = monotonic_time_us();
+  LockAttempt attempt = wait_for_lock(target, 5000, -1, &diagnostics_);
+  int64_t elapsed_ms = (monotonic_time_us() - start) / 1000;
+  owner.join();
+  EXPECT_EQ(attempt.status, LockStatus::kAcquired);
+  EXPECT_LT(elapsed_ms, 2000);
+  if (attempt.status == LockStatus::kAcquired) Release(target, attempt);
+}
+
+TEST_F(InstanceLockTest, WaitForLockStopsWhenCancelled) {
+  LockTarget target = FileTarget();
+  int release_fd = -1;
+  pid_t holder = fork_lock_holder(target, -1, &release_fd);
+  ASSERT_GT(holder, 0);
+
+  int cancel[2];
+  ASSERT_EQ(pipe2(cancel, O_CLOEXEC), 0);
+  std::thread canceller([&] {
+    usleep(100 * 1000);
+    EXPECT_EQ(write(cancel[1], "x", 1), 1);
+  });
+  int64_t start = monotonic_time_us();
+  LockAttempt attempt = wait_for_lock(target, 5000, cancel[0], &diagnostics_);
+  int64_t elapsed_ms = (monotonic_time_us() - start) / 1000;
+  canceller.join();
+  close(cancel[0]);
+  close(cancel[1]);
+  EXPECT_EQ(attempt.status, LockStatus::kHeldByOther);
+  EXPECT_LT(elapsed_ms, 2000);
+
+  close(release_fd);
+  waitpid(holder, nullptr, 0);
+}
+
+TEST_F(InstanceLockTest, RecordsPhases) {
+  LockTarget target = FileTarget();
+  LockAttempt attempt = try_acquire_lock(target, &diagnostics_);
+  ASSERT_EQ(attempt.status, LockStatus::kAcquired);
+  Release(target, attempt);
+
+  std::vector<std::string> names;
+  for (const CheckPhase& phase : diagnostics_.phases) {
+    names.emplace_back(phase.name);
+    EXPECT_GE(phase.start_us, 0);
+    EXPECT_GE(phase.duration_us, 0);
+  }
+  EXPECT_EQ(names, (std::vector<std::string>{"prepareDirectory", "acquireLock", "publishRecord"}));
+}
+
+}  // namespace
+}  // namespace flutter_alone
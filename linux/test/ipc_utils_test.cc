@@ -0,0 +1,214 @@
+#include "ipc_utils.h"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace flutter_alone {
+namespace {
+
+// Serves one launch the way the plugin does: frame, then the fds when the
+// request has any, then the ack. reject closes the connection after the
+// frame instead, like a primary that cannot decode the payload.
+bool ServeLaunch(int listen_fd, LaunchRequest* request, bool* payload_in_memfd,
+                 bool reject = false) {
+  int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd < 0) return false;
+
+  bool served = false;
+  do {
+    char header[kLaunchFrameHeaderSize];
+    if (recv(fd, header, sizeof(header), MSG_WAITALL) != sizeof(header)) break;
+    int64_t length = parse_launch_frame_header(header, payload_in_memfd);
+    if (length < 0) break;
+    if (!*payload_in_memfd) {
+      std::string payload(static_cast<size_t>(length), '\0');
+      if (length > 0 && recv(fd, &payload[0], payload.size(), MSG_WAITALL) != length) break;
+      if (reject) break;
+      if (!decode_launch_request(payload.data(), payload.size(), request)) break;
+    }
+    if (*payload_in_memfd || !request->files.empty()) {
+      pollfd pfd = {fd, POLLIN, 0};
+      std::vector<int> fds;
+      if (poll(&pfd, 1, 5000) != 1 || receive_launch_fds(fd, &fds) != 1) break;
+      if (!attach_launch_fds(&fds, *payload_in_memfd, static_cast<size_t>(length), request)) {
+        break;
+      }
+    }
+    uint8_t ack = kLaunchAckDelivered;
+    served = send(fd, &ack, sizeof(ack), MSG_NOSIGNAL) == 1;
+  } while (false);
+
+  close(fd);
+  return served;
+}
+
+class IpcUtilsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    name_ = "ipc_utils_test." + std::to_string(getpid()) + ".lock";
+    listen_fd_ = create_launch_listener(name_, -1);
+    ASSERT_GE(listen_fd_, 0);
+  }
+
+  void TearDown() override {
+    if (listen_fd_ >= 0) close(listen_fd_);
+  }
+
+  std::string name_;
+  int listen_fd_ = -1;
+};
+
+std::string WriteTempFile(const std::string& contents) {
+  char path[] = "/tmp/flutter_alone_test.XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return std::string();
+  bool written = write(fd, contents.data(), contents.size()) ==
+                 static_cast<ssize_t>(contents.size());
+  close(fd);
+  return written ? path : std::string();
+}
+
+std::string ReadAll(int fd) {
+  std::string contents;
+  char buffer[256];
+  ssize_t n;
+  while ((n = pread(fd, buffer, sizeof(buffer), static_cast<off_t>(contents.size()))) > 0) {
+    contents.append(buffer, static_cast<size_t>(n));
+  }
+  return contents;
+}
+
+TEST_F(IpcUtilsTest, ArgumentFilesReachPrimary) {
+  std::string path = WriteTempFile("hello");
+  ASSERT_FALSE(path.empty());
+  LaunchRequest request;
+  request.arguments = {"--flag", path};
+  open_launch_files(&request, true, false);
+  ASSERT_EQ(request.files.size(), 1u);
+
+  LaunchRequest received;
+  bool in_memfd = true;
+  bool served = false;
+  std::thread primary([&] { served = ServeLaunch(listen_fd_, &received, &in_memfd); });
+  EXPECT_EQ(send_launch_request(name_, -1, request, 0), kLaunchAckDelivered);
+  primary.join();
+  close_launch_files(&request);
+  unlink(path.c_str());
+
+  ASSERT_TRUE(served);
+  EXPECT_FALSE(in_memfd);
+  ASSERT_EQ(received.files.size(), 1u);
+  EXPECT_EQ(received.files[0].argument_index, 1);
+  // The primary reads through our handle, even with the path gone.
+  EXPECT_EQ(ReadAll(received.files[0].fd), "hello");
+  close_launch_files(&received);
+}
+
+TEST_F(IpcUtilsTest, OversizedPayloadGoesThroughMemfd) {
+  LaunchRequest request;
+  request.arguments = {std::string(2 * kMaxLaunchPayloadSize, 'a'), "b"};
+
+  LaunchRequest received;
+  bool in_memfd = false;
+  bool served = false;
+  std::thread primary([&] { served = ServeLaunch(listen_fd_, &received, &in_memfd); });
+  EXPECT_EQ(send_launch_request(name_, -1, request, 0), kLaunchAckDelivered);
+  primary.join();
+
+  ASSERT_TRUE(served);
+  EXPECT_TRUE(in_memfd);
+  EXPECT_EQ(received.arguments, request.arguments);
+  EXPECT_TRUE(received.files.empty());
+}
+
+TEST_F(IpcUtilsTest, RetriesWithoutFilesWhenRejected) {
+  std::string path = WriteTempFile("x");
+  ASSERT_FALSE(path.empty());
+  LaunchRequest request;
+  request.arguments = {path};
+  open_launch_files(&request, true, false);
+  ASSERT_EQ(request.files.size(), 1u);
+
+  LaunchRequest received;
+  bool in_memfd = false;
+  bool served = false;
+  std::thread primary([&] {
+    LaunchRequest rejected;
+    ServeLaunch(listen_fd_, &rejected, &in_memfd, true);
+    served = ServeLaunch(listen_fd_, &received, &in_memfd);
+  });
+  EXPECT_EQ(send_launch_request(name_, -1, request, 0), kLaunchAckDelivered);
+  primary.join();
+  close_launch_files(&request);
+  unlink(path.c_str());
+
+  ASSERT_TRUE(served);
+  EXPECT_EQ(received.arguments, request.arguments);
+  EXPECT_TRUE(received.files.empty());
+}
+
+TEST_F(IpcUtilsTest, EachSlotHasItsOwnEndpoint) {
+  int slot_fd = create_launch_listener(name_, 1);
+  ASSERT_GE(slot_fd, 0);
+  EXPECT_EQ(create_launch_listener(name_, 1), -1);
+  EXPECT_EQ(errno, EADDRINUSE);
+
+  LaunchRequest request;
+  request.arguments = {"slot"};
+  LaunchRequest received;
+  bool in_memfd = false;
+  bool served = false;
+  std::thread primary([&] { served = ServeLaunch(slot_fd, &received, &in_memfd); });
+  EXPECT_EQ(send_launch_request(name_, 1, request, getpid()), kLaunchAckDelivered);
+  primary.join();
+  close(slot_fd);
+
+  ASSERT_TRUE(served);
+  EXPECT_EQ(received.arguments, request.arguments);
+  EXPECT_EQ(send_launch_request(name_, 2, request, 0), kLaunchAckNone);
+}
+
+TEST(IpcUtilsMemfdTest, UnsealedPayloadIsRejected) {
+  LaunchRequest request;
+  request.arguments = {"a"};
+  std::string payload = encode_launch_request(request).substr(kLaunchFrameHeaderSize);
+
+  int memfd = memfd_create("ipc_utils_test", MFD_CLOEXEC);
+  ASSERT_GE(memfd, 0);
+  ASSERT_EQ(write(memfd, payload.data(), payload.size()),
+            static_cast<ssize_t>(payload.size()));
+
+  std::vector<int> fds = {memfd};
+  LaunchRequest received;
+  EXPECT_FALSE(attach_launch_fds(&fds, true, payload.size(), &received));
+  EXPECT_TRUE(fds.empty());
+  EXPECT_EQ(fcntl(memfd, F_GETFD), -1);
+}
+
+TEST(IpcUtilsFilesTest, OnlyRegularFilesAreOpened) {
+  std::string path = WriteTempFile("");
+  ASSERT_FALSE(path.empty());
+  LaunchRequest request;
+  request.arguments = {"/tmp", "-v", "", "/nonexistent/flutter_alone", path};
+  open_launch_files(&request, true, false);
+  unlink(path.c_str());
+
+  ASSERT_EQ(request.files.size(), 1u);
+  EXPECT_EQ(request.files[0].argument_index, 4);
+  EXPECT_EQ(fcntl(request.files[0].fd, F_GETFD) & FD_CLOEXEC, FD_CLOEXEC);
+  close_launch_files(&request);
+  EXPECT_TRUE(request.files.empty());
+}
+
+}  // namespace
+}  // namespace flutter_alone
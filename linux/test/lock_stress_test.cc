@@ -0,0 +1,292 @@
+// Launch-storm harness: forks many contenders that race for the same lock
+// through the plugin's own acquire/verify/release code, and fails if more
+// processes hold it at once than the mode allows. Headless; runs under
+// ctest from the standalone build of linux/CMakeLists.txt.
+//
+//   lock_stress_test [--mode=file|socket|slots] [--contenders=N] [--rounds=N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ipc_utils.h"
+#include "lock_utils.h"
+#include "process_utils.h"
+
+namespace flutter_alone {
+namespace {
+
+constexpr int kSlotCount = 4;
+
+enum class Mode { kFile, kSocket, kSlots };
+
+struct Options {
+  Mode mode = Mode::kFile;
+  int contenders = 200;
+  int rounds = 50;
+};
+
+// Lives in a MAP_SHARED mapping created before fork. The atomics are
+// lock-free, so they work across processes.
+struct SharedState {
+  std::atomic<int> start;
+  std::atomic<int> holders;
+  std::atomic<int> max_holders;
+  std::atomic<int> violations;
+  std::atomic<int> wins;
+  std::atomic<int> errors;
+  // contenders * rounds decision latencies, in nanoseconds.
+  int64_t latency_ns[1];
+};
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// What a rejected launch does with the owner before giving up: read the
+// record and verify the process it names.
+void verify_owner(pid_t pid, uint64_t start_time) {
+  ProcessHandle owner = ProcessHandle::Open(pid, start_time);
+  if (owner.valid()) is_same_program(owner.pid());
+}
+
+class Contender {
+ public:
+  Contender(const Options& options, const std::string& path, const std::string& name)
+      : options_(options), path_(path), name_(name) {}
+
+  // Returns true when the lock (or a slot) was acquired; the latency covers
+  // the whole decision, including owner verification on the losing side.
+  bool Acquire() {
+    switch (options_.mode) {
+      case Mode::kFile: {
+        int held_fd = -1;
+        fd_ = acquire_file_lock(path_, &held_fd);
+        if (fd_ >= 0) {
+          record_ = map_lock_record(fd_);
+          if (record_) {
+            LockRecord self;
+            self.pid = getpid();
+            self.start_time = get_process_start_time(self.pid);
+            publish_lock_record(record_, self, false);
+          }
+          return true;
+        }
+        if (errno != EWOULDBLOCK) error_ = true;
+        if (held_fd >= 0) {
+          LockRecord owner;
+          if (read_lock_record(held_fd, &owner)) verify_owner(owner.pid, owner.start_time);
+          close(held_fd);
+        }
+        return false;
+      }
+      case Mode::kSocket: {
+        fd_ = create_lock_socket(name_);
+        if (fd_ >= 0) return true;
+        if (errno != EADDRINUSE) error_ = true;
+        pid_t owner = get_lock_socket_owner(name_);
+        if (owner > 0) verify_owner(owner, 0);
+        return false;
+      }
+      case Mode::kSlots: {
+        fd_ = open(path_.c_str(), O_CREAT | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+          error_ = true;
+          return false;
+        }
+        slot_ = acquire_lock_slot(fd_, kSlotCount);
+        if (slot_ >= 0) {
+          LockSlotRecord self;
+          self.pid = getpid();
+          self.last_active_ms = current_time_ms();
+          write_lock_slot(fd_, slot_, self, false);
+          return true;
+        }
+        if (errno != EAGAIN && errno != EACCES) error_ = true;
+        read_lock_slots(fd_, kSlotCount);
+        close(fd_);
+        fd_ = -1;
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // Mirrors release_lock() for the mode.
+  void Release() {
+    switch (options_.mode) {
+      case Mode::kFile:
+        unmap_lock_record(record_);
+        record_ = nullptr;
+        release_file_lock(path_, fd_);
+        break;
+      case Mode::kSocket:
+        close(fd_);
+        break;
+      case Mode::kSlots:
+        write_lock_slot(fd_, slot_, LockSlotRecord(), false);
+        close(fd_);
+        slot_ = -1;
+        break;
+    }
+    fd_ = -1;
+  }
+
+  bool error() const { return error_; }
+
+ private:
+  const Options& options_;
+  const std::string& path_;
+  const std::string& name_;
+  int fd_ = -1;
+  int slot_ = -1;
+  LockRecordPage* record_ = nullptr;
+  bool error_ = false;
+};
+
+void run_contender(const Options& options, const std::string& path, const std::string& name,
+                   int index, SharedState* shared) {
+  const int limit = options.mode == Mode::kSlots ? kSlotCount : 1;
+  srand(static_cast<unsigned>(getpid()));
+  while (!shared->start.load(std::memory_order_acquire)) sched_yield();
+
+  Contender contender(options, path, name);
+  for (int round = 0; round < options.rounds; round++) {
+    int64_t begin = now_ns();
+    bool won = contender.Acquire();
+    shared->latency_ns[index * options.rounds + round] = now_ns() - begin;
+    if (!won) {
+      // Spread retries so they also land in the owners' release windows.
+      usleep(static_cast<useconds_t>(rand() % 100));
+      continue;
+    }
+
+    int holders = shared->holders.fetch_add(1) + 1;
+    if (holders > limit) shared->violations.fetch_add(1);
+    int max = shared->max_holders.load();
+    while (holders > max && !shared->max_holders.compare_exchange_weak(max, holders)) {}
+    shared->wins.fetch_add(1);
+
+    // Hold briefly so others pile up behind the lock.
+    usleep(static_cast<useconds_t>(rand() % 200));
+
+    // Step down before releasing: from here on another winner is allowed.
+    shared->holders.fetch_sub(1);
+    contender.Release();
+  }
+  if (contender.error()) shared->errors.fetch_add(1);
+}
+
+bool parse_options(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--mode=file") == 0) {
+      options->mode = Mode::kFile;
+    } else if (strcmp(arg, "--mode=socket") == 0) {
+      options->mode = Mode::kSocket;
+    } else if (strcmp(arg, "--mode=slots") == 0) {
+      options->mode = Mode::kSlots;
+    } else if (strncmp(arg, "--contenders=", 13) == 0) {
+      options->contenders = atoi(arg + 13);
+    } else if (strncmp(arg, "--rounds=", 9) == 0) {
+      options->rounds = atoi(arg + 9);
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", arg);
+      return false;
+    }
+  }
+  return options->contenders > 0 && options->rounds > 0;
+}
+
+const char* mode_name(Mode mode) {
+  switch (mode) {
+    case Mode::kFile: return "file";
+    case Mode::kSocket: return "socket";
+    case Mode::kSlots: return "slots";
+  }
+  return "?";
+}
+
+int run(const Options& options) {
+  const char* tmp = getenv("TMPDIR");
+  std::string name = "flutter_alone_stress." + std::to_string(getpid());
+  std::string path = std::string(tmp && *tmp ? tmp : "/tmp") + "/" + name;
+
+  size_t samples = static_cast<size_t>(options.contenders) * options.rounds;
+  size_t size = sizeof(SharedState) + samples * sizeof(int64_t);
+  void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    perror("mmap");
+    return 2;
+  }
+  SharedState* shared = new (mapping) SharedState();
+
+  std::vector<pid_t> children;
+  for (int i = 0; i < options.contenders; i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      run_contender(options, path, name, i, shared);
+      _exit(0);
+    }
+    if (pid < 0) {
+      perror("fork");
+      break;
+    }
+    children.push_back(pid);
+  }
+  shared->start.store(1, std::memory_order_release);
+
+  int crashed = 0;
+  for (pid_t child : children) {
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) crashed++;
+  }
+  unlink(path.c_str());
+
+  std::vector<int64_t> latencies(shared->latency_ns,
+                                 shared->latency_ns + children.size() * options.rounds);
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile_us = [&latencies](double p) {
+    if (latencies.empty()) return 0.0;
+    size_t index = std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+    return latencies[index] / 1000.0;
+  };
+
+  printf("mode=%s contenders=%zu rounds=%d\n", mode_name(options.mode), children.size(),
+         options.rounds);
+  printf("wins=%d max_concurrent_holders=%d violations=%d errors=%d crashed=%d\n",
+         shared->wins.load(), shared->max_holders.load(), shared->violations.load(),
+         shared->errors.load(), crashed);
+  printf("decision latency: p50=%.1fus p99=%.1fus max=%.1fus\n", percentile_us(0.50),
+         percentile_us(0.99), latencies.empty() ? 0.0 : latencies.back() / 1000.0);
+
+  bool ok = static_cast<int>(children.size()) == options.contenders &&
+            shared->violations.load() == 0 && shared->wins.load() > 0 &&
+            shared->errors.load() == 0 && crashed == 0;
+  munmap(mapping, size);
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace flutter_alone
+
+int main(int argc, char** argv) {
+  flutter_alone::Options options;
+  if (!flutter_alone::parse_options(argc, argv, &options)) return 2;
+  return flutter_alone::run(options);
+}
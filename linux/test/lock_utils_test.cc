@@ -0,0 +1,159 @@
+#include "lock_utils.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace flutter_alone {
+namespace {
+
+class LockUtilsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/flutter_alone_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+    path_ = dir_ + "/app.lock";
+  }
+
+  void TearDown() override {
+    unlink(path_.c_str());
+    rmdir(dir_.c_str());
+  }
+
+  int OpenFile() { return open(path_.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644); }
+
+  std::string dir_;
+  std::string path_;
+};
+
+TEST_F(LockUtilsTest, SecondAcquireSeesHeldLock) {
+  int fd = acquire_file_lock(path_, nullptr);
+  ASSERT_GE(fd, 0);
+
+  int held_fd = -1;
+  EXPECT_EQ(acquire_file_lock(path_, &held_fd), -1);
+  EXPECT_EQ(errno, EWOULDBLOCK);
+  EXPECT_GE(held_fd, 0);
+  close(held_fd);
+
+  EXPECT_TRUE(release_file_lock(path_, fd));
+}
+
+TEST_F(LockUtilsTest, ReleaseUnlinksBeforeNextOwner) {
+  int fd = acquire_file_lock(path_, nullptr);
+  ASSERT_GE(fd, 0);
+  ASSERT_TRUE(release_file_lock(path_, fd));
+  struct stat st;
+  EXPECT_NE(lstat(path_.c_str(), &st), 0);
+
+  fd = acquire_file_lock(path_, nullptr);
+  ASSERT_GE(fd, 0);
+  EXPECT_TRUE(release_file_lock(path_, fd));
+}
+
+TEST_F(LockUtilsTest, LockOnUnlinkedFileIsNotKept) {
+  // A contender that opened the file before the owner's release ends up
+  // locking a file that is no longer at the path.
+  int stale = OpenFile();
+  ASSERT_GE(stale, 0);
+  ASSERT_EQ(unlink(path_.c_str()), 0);
+
+  int fd = acquire_file_lock(path_, nullptr);
+  ASSERT_GE(fd, 0);
+  struct stat locked, current;
+  ASSERT_EQ(fstat(fd, &locked), 0);
+  ASSERT_EQ(lstat(path_.c_str(), &current), 0);
+  EXPECT_EQ(locked.st_ino, current.st_ino);
+  close(stale);
+  EXPECT_TRUE(release_file_lock(path_, fd));
+}
+
+TEST_F(LockUtilsTest, RecordRoundTrip) {
+  int fd = acquire_file_lock(path_, nullptr);
+  ASSERT_GE(fd, 0);
+  LockRecordPage* page = map_lock_record(fd);
+  ASSERT_NE(page, nullptr);
+
+  LockRecord record;
+  record.pid = getpid();
+  record.start_time = 1234;
+  record.boot_id = "boot";
+  record.exe_dev = 1;
+  record.exe_ino = 2;
+  record.display = ":0";
+  record.ipc_address = "flutter_alone.launch";
+  publish_lock_record(page, record, false);
+  set_lock_record_window(page, 0x4200001);
+
+  LockRecord read;
+  ASSERT_TRUE(read_lock_record(fd, &read));
+  EXPECT_TRUE(read.versioned);
+  EXPECT_EQ(read.pid, record.pid);
+  EXPECT_EQ(read.start_time, 1234u);
+  EXPECT_EQ(read.boot_id, "boot");
+  EXPECT_EQ(read.exe_ino, 2u);
+  EXPECT_EQ(read.display, ":0");
+  EXPECT_EQ(read.window_id, 0x4200001u);
+  EXPECT_EQ(read.ipc_address, "flutter_alone.launch");
+
+  unmap_lock_record(page);
+  release_file_lock(path_, fd);
+}
+
+TEST_F(LockUtilsTest, ReadsLegacyTextPid) {
+  int fd = OpenFile();
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "4321\n", 5), 5);
+
+  LockRecord record;
+  ASSERT_TRUE(read_lock_record(fd, &record));
+  EXPECT_FALSE(record.versioned);
+  EXPECT_EQ(record.pid, 4321);
+  close(fd);
+}
+
+TEST_F(LockUtilsTest, EmptyFileHasNoRecord) {
+  int fd = OpenFile();
+  ASSERT_GE(fd, 0);
+  LockRecord record;
+  EXPECT_FALSE(read_lock_record(fd, &record));
+  close(fd);
+}
+
+TEST_F(LockUtilsTest, SlotsAreExclusivePerDescription) {
+  int first = OpenFile();
+  int second = OpenFile();
+  int third = OpenFile();
+  ASSERT_GE(first, 0);
+
+  EXPECT_EQ(acquire_lock_slot(first, 2), 0);
+  EXPECT_EQ(acquire_lock_slot(second, 2), 1);
+  EXPECT_EQ(acquire_lock_slot(third, 2), -1);
+
+  LockSlotRecord record;
+  record.pid = getpid();
+  record.last_active_ms = 99;
+  record.window_id = 7;
+  ASSERT_TRUE(write_lock_slot(second, 1, record, false));
+  std::vector<LockSlotRecord> slots = read_lock_slots(third, 2);
+  ASSERT_EQ(slots.size(), 2u);
+  EXPECT_EQ(slots[0].pid, 0);
+  EXPECT_EQ(slots[1].pid, getpid());
+  EXPECT_EQ(slots[1].last_active_ms, 99);
+  EXPECT_EQ(slots[1].window_id, 7u);
+
+  // Closing a description frees its slot.
+  close(first);
+  EXPECT_EQ(acquire_lock_slot(third, 2), 0);
+  close(second);
+  close(third);
+}
+
+}  // namespace
+}  // namespace flutter_alone
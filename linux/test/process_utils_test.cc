@@ -0,0 +1,131 @@
+#include "process_utils.h"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace flutter_alone {
+namespace {
+
+// A child that waits until told to exit, for identity checks on a process
+// other than ourselves.
+class ChildProcess {
+ public:
+  ChildProcess() {
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    pid_ = fork();
+    if (pid_ == 0) {
+      close(fds[1]);
+      char c;
+      while (read(fds[0], &c, 1) < 0 && errno == EINTR) {}
+      _exit(0);
+    }
+    close(fds[0]);
+    release_fd_ = fds[1];
+  }
+
+  ~ChildProcess() { Reap(); }
+
+  void Reap() {
+    if (pid_ <= 0) return;
+    close(release_fd_);
+    waitpid(pid_, nullptr, 0);
+    pid_ = 0;
+  }
+
+  pid_t pid() const { return pid_; }
+
+ private:
+  pid_t pid_ = 0;
+  int release_fd_ = -1;
+};
+
+TEST(ProcessUtilsTest, StartTimeIdentifiesProcess) {
+  EXPECT_NE(get_process_start_time(getpid()), 0u);
+  EXPECT_EQ(get_process_start_time(getpid()), get_process_start_time(getpid()));
+  EXPECT_EQ(get_process_start_time(-1), 0u);
+}
+
+TEST(ProcessUtilsTest, ExecutableIdMatchesSelf) {
+  uint64_t dev = 0, ino = 0;
+  ASSERT_TRUE(get_executable_id(getpid(), &dev, &ino));
+  EXPECT_EQ(dev, get_self_executable().dev);
+  EXPECT_EQ(ino, get_self_executable().ino);
+}
+
+TEST(ProcessUtilsTest, ForkedChildIsSameProgram) {
+  ChildProcess child;
+  ASSERT_GT(child.pid(), 0);
+  EXPECT_TRUE(is_same_program(child.pid()));
+  EXPECT_FALSE(is_same_program(-1));
+}
+
+TEST(ProcessUtilsTest, HandleRejectsWrongStartTime) {
+  ChildProcess child;
+  ASSERT_GT(child.pid(), 0);
+  uint64_t start_time = get_process_start_time(child.pid());
+  ASSERT_NE(start_time, 0u);
+
+  EXPECT_FALSE(ProcessHandle::Open(child.pid(), start_time + 1).valid());
+  EXPECT_TRUE(ProcessHandle::Open(child.pid(), 0).valid());
+}
+
+TEST(ProcessUtilsTest, HandleSeesExit) {
+  ChildProcess child;
+  ASSERT_GT(child.pid(), 0);
+  ProcessHandle handle = ProcessHandle::Open(child.pid(), get_process_start_time(child.pid()));
+  ASSERT_TRUE(handle.valid());
+  EXPECT_TRUE(handle.IsAlive());
+
+  child.Reap();
+  EXPECT_FALSE(handle.IsAlive());
+}
+
+TEST(ProcessUtilsTest, HandleFdBecomesReadableOnExit) {
+  ChildProcess child;
+  ASSERT_GT(child.pid(), 0);
+  ProcessHandle handle = ProcessHandle::Open(child.pid(), get_process_start_time(child.pid()));
+  ASSERT_TRUE(handle.valid());
+  if (handle.fd() < 0) GTEST_SKIP() << "pidfd_open not supported";
+
+  pollfd pfd = {handle.fd(), POLLIN, 0};
+  EXPECT_EQ(poll(&pfd, 1, 0), 0);
+  child.Reap();
+  EXPECT_EQ(poll(&pfd, 1, 1000), 1);
+}
+
+TEST(ProcessUtilsTest, WaitForExitTimesOutWhileAlive) {
+  ChildProcess child;
+  ASSERT_GT(child.pid(), 0);
+  ProcessHandle handle = ProcessHandle::Open(child.pid(), get_process_start_time(child.pid()));
+  ASSERT_TRUE(handle.valid());
+  int64_t start = monotonic_time_us();
+  EXPECT_FALSE(handle.WaitForExit(50));
+  EXPECT_GE(monotonic_time_us() - start, 50 * 1000);
+
+  child.Reap();
+  EXPECT_TRUE(handle.WaitForExit(1000));
+}
+
+TEST(ProcessUtilsTest, RunCommandReportsExitStatus) {
+  char* true_argv[] = {const_cast<char*>("true"), nullptr};
+  char* false_argv[] = {const_cast<char*>("false"), nullptr};
+  EXPECT_TRUE(run_command("true", true_argv, 5000));
+  EXPECT_FALSE(run_command("false", false_argv, 5000));
+}
+
+TEST(ProcessUtilsTest, RunCommandKillsSlowChild) {
+  char* argv[] = {const_cast<char*>("sleep"), const_cast<char*>("10"), nullptr};
+  int64_t start = monotonic_time_us();
+  EXPECT_FALSE(run_command("sleep", argv, 50));
+  EXPECT_EQ(errno, ETIMEDOUT);
+  EXPECT_LT(monotonic_time_us() - start, 5 * 1000 * 1000);
+}
+
+}  // namespace
+}  // namespace flutter_alone
@@ -0,0 +1,89 @@
+#include "registry_utils.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "process_utils.h"
+
+namespace flutter_alone {
+namespace {
+
+class RegistryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    name_ = "registry_test." + std::to_string(getpid()) + ".lock";
+    registry_ = InstanceRegistry::Open(name_);
+    ASSERT_NE(registry_, nullptr);
+  }
+
+  void TearDown() override {
+    registry_.reset();
+    shm_unlink(("/flutter_alone." + std::to_string(getuid()) + "." + name_).c_str());
+  }
+
+  InstanceInfo Self(uint32_t flags) {
+    InstanceInfo info;
+    info.pid = getpid();
+    info.start_time = get_process_start_time(info.pid);
+    info.flags = flags;
+    info.endpoint = "flutter_alone.launch";
+    return info;
+  }
+
+  std::string name_;
+  std::unique_ptr<InstanceRegistry> registry_;
+};
+
+TEST_F(RegistryTest, RegisterListUnregister) {
+  int index = registry_->Register(Self(kInstanceFlagPrimary | kInstanceFlagAcceptsLaunches));
+  ASSERT_GE(index, 0);
+
+  std::vector<InstanceInfo> live = registry_->List();
+  ASSERT_EQ(live.size(), 1u);
+  EXPECT_EQ(live[0].pid, getpid());
+  EXPECT_EQ(live[0].endpoint, "flutter_alone.launch");
+  EXPECT_NE(live[0].flags & kInstanceFlagAcceptsLaunches, 0u);
+
+  registry_->Unregister(index);
+  EXPECT_TRUE(registry_->List().empty());
+}
+
+TEST_F(RegistryTest, FindPrimaryIgnoresSecondaries) {
+  InstanceInfo primary;
+  int secondary = registry_->Register(Self(0));
+  ASSERT_GE(secondary, 0);
+  EXPECT_FALSE(registry_->FindPrimary(&primary));
+
+  int index = registry_->Register(Self(kInstanceFlagPrimary));
+  ASSERT_GE(index, 0);
+  registry_->SetWindow(index, 0x1c00003);
+  ASSERT_TRUE(registry_->FindPrimary(&primary));
+  EXPECT_EQ(primary.pid, getpid());
+  EXPECT_EQ(primary.window_id, 0x1c00003u);
+  EXPECT_NE(primary.flags & kInstanceFlagWindowReady, 0u);
+}
+
+TEST_F(RegistryTest, DropsEntriesOfReusedPids) {
+  InstanceInfo stale = Self(kInstanceFlagPrimary);
+  stale.start_time += 1;
+  ASSERT_GE(registry_->Register(stale), 0);
+
+  InstanceInfo primary;
+  EXPECT_FALSE(registry_->FindPrimary(&primary));
+  EXPECT_TRUE(registry_->List().empty());
+}
+
+TEST_F(RegistryTest, SharedBetweenMappings) {
+  ASSERT_GE(registry_->Register(Self(kInstanceFlagPrimary)), 0);
+  std::unique_ptr<InstanceRegistry> other = InstanceRegistry::Open(name_);
+  ASSERT_NE(other, nullptr);
+  InstanceInfo primary;
+  EXPECT_TRUE(other->FindPrimary(&primary));
+}
+
+}  // namespace
+}  // namespace flutter_alone
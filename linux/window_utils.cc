@@ -0,0 +1,343 @@
+#include "window_utils.h"
+
+#ifdef HAVE_X11
+
+#include <X11/Xatom.h>
+
+#ifdef HAVE_XCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif
+
+#ifdef HAVE_XRES
+#include <X11/extensions/XRes.h>
+#endif
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace flutter_alone {
+
+namespace {
+
+// Page size, in windows, for reading _NET_CLIENT_LIST.
+constexpr long kMaxClientListItems = 4096;
+
+#ifdef HAVE_XCB
+
+// Reads the whole _NET_CLIENT_LIST, one kMaxClientListItems page per round
+// trip.
+bool read_client_list_xcb(xcb_connection_t* conn, xcb_window_t root,
+                          xcb_atom_t client_list, std::vector<xcb_window_t>* windows) {
+  uint32_t offset = 0;
+  for (;;) {
+    xcb_get_property_cookie_t cookie = xcb_get_property(
+        conn, 0, root, client_list, XCB_ATOM_WINDOW, offset, kMaxClientListItems);
+    xcb_generic_error_t* error = nullptr;
+    xcb_get_property_reply_t* reply = xcb_get_property_reply(conn, cookie, &error);
+    free(error);
+    if (!reply) return false;
+
+    bool valid = reply->type == XCB_ATOM_WINDOW && reply->format == 32;
+    int count = valid ? xcb_get_property_value_length(reply) / 4 : 0;
+    const xcb_window_t* values =
+        static_cast<const xcb_window_t*>(xcb_get_property_value(reply));
+    windows->insert(windows->end(), values, values + count);
+    uint32_t bytes_after = reply->bytes_after;
+    free(reply);
+
+    if (!valid || bytes_after == 0 || count == 0) return valid;
+    offset += static_cast<uint32_t>(count);
+  }
+}
+
+// Sends every _NET_WM_PID request before reading the first reply, so the
+// lookup costs one round trip regardless of how many windows are managed.
+Window find_window_by_pid_xcb(Display* display, const X11Atoms& atoms, pid_t target_pid) {
+  xcb_connection_t* conn = XGetXCBConnection(display);
+  xcb_window_t root = static_cast<xcb_window_t>(DefaultRootWindow(display));
+
+  std::vector<xcb_window_t> windows;
+  if (!read_client_list_xcb(conn, root, static_cast<xcb_atom_t>(atoms.client_list), &windows)) {
+    return None;
+  }
+
+  std::vector<xcb_get_property_cookie_t> cookies;
+  cookies.reserve(windows.size());
+  for (xcb_window_t window : windows) {
+    cookies.push_back(xcb_get_property(conn, 0, window, static_cast<xcb_atom_t>(atoms.wm_pid),
+                                       XCB_ATOM_CARDINAL, 0, 1));
+  }
+
+  Window found = None;
+  for (size_t i = 0; i < cookies.size(); i++) {
+    if (found != None) {
+      xcb_discard_reply(conn, cookies[i].sequence);
+      continue;
+    }
+    // Collect errors (e.g. BadWindow for a window that just closed) here so
+    // they never reach the Xlib error handler.
+    xcb_generic_error_t* error = nullptr;
+    xcb_get_property_reply_t* reply = xcb_get_property_reply(conn, cookies[i], &error);
+    free(error);
+    if (!reply) continue;
+    if (reply->format == 32 && xcb_get_property_value_length(reply) >= 4) {
+      uint32_t window_pid = 0;
+      memcpy(&window_pid, xcb_get_property_value(reply), sizeof(window_pid));
+      if (static_cast<pid_t>(window_pid) == target_pid) found = windows[i];
+    }
+    free(reply);
+  }
+  return found;
+}
+
+#else  // HAVE_XCB
+
+// Reads the whole _NET_CLIENT_LIST, one kMaxClientListItems page per round
+// trip.
+bool read_client_list_xlib(Display* display, Window root, Atom client_list,
+                           std::vector<Window>* windows) {
+  long offset = 0;
+  for (;;) {
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems, bytes_after;
+    unsigned char* prop_data = nullptr;
+
+    if (XGetWindowProperty(display, root, client_list,
+                           offset, kMaxClientListItems, False, XA_WINDOW,
+                           &actual_type, &actual_format,
+                           &nitems, &bytes_after, &prop_data) != Success) {
+      return false;
+    }
+    if (!prop_data) return actual_type != None;
+
+    Window* values = reinterpret_cast<Window*>(prop_data);
+    windows->insert(windows->end(), values, values + nitems);
+    XFree(prop_data);
+
+    if (bytes_after == 0 || nitems == 0) return true;
+    offset += static_cast<long>(nitems);
+  }
+}
+
+Window find_window_by_pid_xlib(Display* display, const X11Atoms& atoms, pid_t target_pid) {
+  std::vector<Window> windows;
+  if (!read_client_list_xlib(display, DefaultRootWindow(display), atoms.client_list, &windows)) {
+    return None;
+  }
+
+  for (Window window : windows) {
+    unsigned char* pid_data = nullptr;
+    Atom pid_actual_type;
+    int pid_actual_format;
+    unsigned long pid_nitems, pid_bytes_after;
+
+    if (XGetWindowProperty(display, window, atoms.wm_pid,
+                           0, 1, False, XA_CARDINAL,
+                           &pid_actual_type, &pid_actual_format,
+                           &pid_nitems, &pid_bytes_after, &pid_data) == Success) {
+      if (pid_data && pid_nitems > 0) {
+        uint32_t window_pid = 0;
+        memcpy(&window_pid, pid_data, sizeof(uint32_t));
+        XFree(pid_data);
+        if (static_cast<pid_t>(window_pid) == target_pid) return window;
+      } else if (pid_data) {
+        XFree(pid_data);
+      }
+    }
+  }
+  return None;
+}
+
+#endif  // HAVE_XCB
+
+int ignore_x_error(Display* display, XErrorEvent* event) {
+  return 0;
+}
+
+#ifdef HAVE_XRES
+
+bool read_client_list(Display* display, Atom client_list, std::vector<Window>* windows) {
+#ifdef HAVE_XCB
+  std::vector<xcb_window_t> xcb_windows;
+  if (!read_client_list_xcb(XGetXCBConnection(display),
+                            static_cast<xcb_window_t>(DefaultRootWindow(display)),
+                            static_cast<xcb_atom_t>(client_list), &xcb_windows)) {
+    return false;
+  }
+  windows->assign(xcb_windows.begin(), xcb_windows.end());
+  return true;
+#else
+  return read_client_list_xlib(display, DefaultRootWindow(display), client_list, windows);
+#endif
+}
+
+#endif  // HAVE_XRES
+
+}  // namespace
+
+ScopedXErrorTrap::ScopedXErrorTrap(Display* display)
+    : display_(display), previous_(XSetErrorHandler(ignore_x_error)) {}
+
+ScopedXErrorTrap::~ScopedXErrorTrap() {
+  XSync(display_, False);
+  XSetErrorHandler(previous_);
+}
+
+X11Atoms intern_x11_atoms(Display* display) {
+  char* names[] = {
+    const_cast<char*>("_NET_WM_PID"),
+    const_cast<char*>("_NET_CLIENT_LIST"),
+    const_cast<char*>("_NET_ACTIVE_WINDOW"),
+  };
+  Atom values[3] = {None, None, None};
+
+  // Return status is non-zero only when every atom exists; missing ones are
+  // simply left None, which callers already handle.
+  XInternAtoms(display, names, 3, True, values);
+
+  X11Atoms atoms;
+  atoms.wm_pid = values[0];
+  atoms.client_list = values[1];
+  atoms.active_window = values[2];
+  return atoms;
+}
+
+Window find_window_by_pid(Display* display, const X11Atoms& atoms, pid_t target_pid) {
+  if (atoms.wm_pid == None || atoms.client_list == None) return None;
+#ifdef HAVE_XCB
+  return find_window_by_pid_xcb(display, atoms, target_pid);
+#else
+  return find_window_by_pid_xlib(display, atoms, target_pid);
+#endif
+}
+
+bool window_belongs_to_pid(Display* display, const X11Atoms& atoms, Window window,
+                           pid_t target_pid) {
+  if (window == None || atoms.wm_pid == None || target_pid <= 0) return false;
+  uint32_t window_pid = 0;
+#ifdef HAVE_XCB
+  xcb_connection_t* conn = XGetXCBConnection(display);
+  xcb_get_property_cookie_t cookie =
+      xcb_get_property(conn, 0, static_cast<xcb_window_t>(window),
+                       static_cast<xcb_atom_t>(atoms.wm_pid), XCB_ATOM_CARDINAL, 0, 1);
+  xcb_generic_error_t* error = nullptr;
+  xcb_get_property_reply_t* reply = xcb_get_property_reply(conn, cookie, &error);
+  free(error);
+  if (!reply) return false;
+  bool valid = reply->format == 32 && xcb_get_property_value_length(reply) >= 4;
+  if (valid) memcpy(&window_pid, xcb_get_property_value(reply), sizeof(window_pid));
+  free(reply);
+  if (!valid) return false;
+#else
+  // The error handler is left alone: swapping the process-global handler
+  // here would race GDK's own traps. A BadWindow reaches the caller's trap,
+  // and XGetWindowProperty then fails, which is all we need to know.
+  Atom actual_type;
+  int actual_format;
+  unsigned long nitems, bytes_after;
+  unsigned char* pid_data = nullptr;
+  int status = XGetWindowProperty(display, window, atoms.wm_pid, 0, 1, False, XA_CARDINAL,
+                                  &actual_type, &actual_format, &nitems, &bytes_after,
+                                  &pid_data);
+  if (status != Success || !pid_data) return false;
+  bool valid = actual_format == 32 && nitems > 0;
+  if (valid) memcpy(&window_pid, pid_data, sizeof(window_pid));
+  XFree(pid_data);
+  if (!valid) return false;
+#endif
+  return static_cast<pid_t>(window_pid) == target_pid;
+}
+
+#ifdef HAVE_XRES
+
+XResInfo query_xres_info(Display* display) {
+  XResInfo info;
+  int event_base, error_base, major = 0, minor = 0;
+  if (!XResQueryExtension(display, &event_base, &error_base) ||
+      !XResQueryVersion(display, &major, &minor)) {
+    return info;
+  }
+  // XResQueryClientIds needs protocol 1.2.
+  if (major < 1 || (major == 1 && minor < 2)) return info;
+
+  // Every client gets an equally sized XID range; read its mask once.
+  int num_clients = 0;
+  XResClient* clients = nullptr;
+  if (XResQueryClients(display, &num_clients, &clients) && clients) {
+    if (num_clients > 0) {
+      info.client_mask = clients[0].resource_mask;
+      info.available = info.client_mask != 0;
+    }
+    XFree(clients);
+  }
+  return info;
+}
+
+Window find_window_by_pid_xres(Display* display, const X11Atoms& atoms,
+                               const XResInfo& xres, pid_t target_pid) {
+  if (!xres.available || atoms.client_list == None) return None;
+
+  // client = None selects all clients; the server fills in the PID it got
+  // from each local client's socket credentials.
+  XResClientIdSpec spec;
+  spec.client = None;
+  spec.mask = XRES_CLIENT_ID_PID_MASK;
+  long num_ids = 0;
+  XResClientIdValue* ids = nullptr;
+  if (XResQueryClientIds(display, 1, &spec, &num_ids, &ids) != Success) return None;
+
+  XID client_base = None;
+  for (long i = 0; i < num_ids; i++) {
+    if (XResGetClientIdType(&ids[i]) == XRES_CLIENT_ID_PID &&
+        XResGetClientPid(&ids[i]) == target_pid) {
+      client_base = ids[i].spec.client & ~xres.client_mask;
+      break;
+    }
+  }
+  XResClientIdsDestroy(num_ids, ids);
+  if (client_base == None) return None;
+
+  std::vector<Window> windows;
+  if (!read_client_list(display, atoms.client_list, &windows)) return None;
+  for (Window window : windows) {
+    if ((window & ~xres.client_mask) == client_base) return window;
+  }
+  return None;
+}
+
+#endif  // HAVE_XRES
+
+bool activate_x11_window(Display* display, const X11Atoms& atoms, Window target) {
+  if (atoms.active_window == None) return true;
+
+  Window root = DefaultRootWindow(display);
+  XEvent event;
+  memset(&event, 0, sizeof(event));
+  event.xclient.type = ClientMessage;
+  event.xclient.serial = 0;
+  event.xclient.send_event = True;
+  event.xclient.display = display;
+  event.xclient.window = target;
+  event.xclient.message_type = atoms.active_window;
+  event.xclient.format = 32;
+  // Source indication: 2 = pager (EWMH spec _NET_ACTIVE_WINDOW)
+  event.xclient.data.l[0] = 2;
+  event.xclient.data.l[1] = CurrentTime;
+  event.xclient.data.l[2] = 0;
+
+  XSendEvent(display, root, False,
+             SubstructureRedirectMask | SubstructureNotifyMask,
+             &event);
+
+  XMapRaised(display, target);
+  XFlush(display);
+  return true;
+}
+
+}  // namespace flutter_alone
+
+#endif  // HAVE_X11
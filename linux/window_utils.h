@@ -0,0 +1,88 @@
+#ifndef FLUTTER_PLUGIN_WINDOW_UTILS_H_
+#define FLUTTER_PLUGIN_WINDOW_UTILS_H_
+
+#ifdef HAVE_X11
+
+#include <X11/Xlib.h>
+#include <sys/types.h>
+
+namespace flutter_alone {
+
+// EWMH atoms used for activation. Atoms the server does not know yet stay
+// None (interned with only_if_exists).
+struct X11Atoms {
+  Atom wm_pid = None;
+  Atom client_list = None;
+  Atom active_window = None;
+};
+
+// Absorbs every X error while alive, so a BadWindow for a window closed
+// mid-lookup cannot reach Xlib's default handler, which exits the process.
+// Xlib's error handler is process-global: only use this for a connection
+// GDK does not manage, on the thread GDK runs on (or before GDK exists),
+// and use gdk_x11_display_error_trap_push() on GDK's own Display. Pending
+// errors are collected with XSync before the previous handler returns.
+class ScopedXErrorTrap {
+ public:
+  explicit ScopedXErrorTrap(Display* display);
+  ~ScopedXErrorTrap();
+  ScopedXErrorTrap(const ScopedXErrorTrap&) = delete;
+  ScopedXErrorTrap& operator=(const ScopedXErrorTrap&) = delete;
+
+ private:
+  Display* display_;
+  XErrorHandler previous_;
+};
+
+// Interns every atom in X11Atoms with a single XInternAtoms round trip.
+// The result is valid for the lifetime of the connection.
+X11Atoms intern_x11_atoms(Display* display);
+
+// Returns the first managed top-level window whose _NET_WM_PID matches
+// target_pid, or None. The whole _NET_CLIENT_LIST is inspected. Built with
+// HAVE_XCB, all property requests are pipelined over the display's XCB
+// connection; otherwise one synchronous Xlib round trip is made per window,
+// and the caller must trap errors (ScopedXErrorTrap or GDK's trap) because
+// any window may be destroyed during the scan.
+Window find_window_by_pid(Display* display, const X11Atoms& atoms, pid_t target_pid);
+
+// True when window still exists and its _NET_WM_PID is target_pid. One
+// round trip. With HAVE_XCB the BadWindow error for a window that is gone
+// is collected through a checked cookie; otherwise it goes to the caller's
+// trap (ScopedXErrorTrap or GDK's), as the process-global handler is never
+// swapped here.
+// Used to validate a window id published by target_pid itself before
+// activating it, instead of searching _NET_CLIENT_LIST.
+bool window_belongs_to_pid(Display* display, const X11Atoms& atoms, Window window,
+                           pid_t target_pid);
+
+#ifdef HAVE_XRES
+
+// X-Resource extension state for a connection, queried once.
+struct XResInfo {
+  // Server supports XResQueryClientIds (protocol 1.2 or later).
+  bool available = false;
+  // XID bits that identify a resource within its owning client.
+  XID client_mask = 0;
+};
+
+XResInfo query_xres_info(Display* display);
+
+// Maps target_pid to its X client with one XResQueryClientIds request and
+// returns that client's first window in _NET_CLIENT_LIST, or None. The PID
+// comes from the server (local clients only), not from a client-set
+// property, and the cost does not grow with the number of windows.
+Window find_window_by_pid_xres(Display* display, const X11Atoms& atoms,
+                               const XResInfo& xres, pid_t target_pid);
+
+#endif  // HAVE_XRES
+
+// Asks the window manager to activate target (_NET_ACTIVE_WINDOW) and maps
+// it raised, then flushes. Does not close or sync the connection.
+bool activate_x11_window(Display* display, const X11Atoms& atoms, Window target);
+
+}  // namespace flutter_alone
+
+#endif  // HAVE_X11
+
+#endif  // FLUTTER_PLUGIN_WINDOW_UTILS_H_